@@ -0,0 +1,73 @@
+#include "Agent.h"
+#include "Autopilot.h"
+#include "Hamilton.h"
+#include "Mcts.h"
+
+#include <cstdlib>
+
+static const Action ACTIONS[3] = { Action::STRAIGHT, Action::LEFT, Action::RIGHT };
+
+int orientationAfter(const Snake& snake, Action action) {
+	if (action == Action::RIGHT) {
+		return (snake.orientation + 1) % 4;
+	}
+	if (action == Action::LEFT) {
+		return (snake.orientation + 3) % 4;
+	}
+	return snake.orientation;
+}
+
+void RandomAgent::reset(BoardSize, uint64_t seed, uint64_t stream) {
+	// flipped seed, so the moves don't mirror the candy sequence
+	rng.reseed(~seed, stream);
+}
+
+Action RandomAgent::decide(const Snake& snake) {
+	Action safe[3];
+	int count = 0;
+	for (Action action : ACTIONS) {
+		if (snake.isFree(Snake::step(snake.getHead(), orientationAfter(snake, action)))) {
+			safe[count++] = action;
+		}
+	}
+	if (count == 0) {
+		return Action::STRAIGHT;
+	}
+	return safe[rng.below(count)];
+}
+
+Action GreedyAgent::decide(const Snake& snake) {
+	Action best = Action::STRAIGHT;
+	int best_dist = -1;
+	for (Action action : ACTIONS) {
+		std::pair<int, int> next = Snake::step(snake.getHead(), orientationAfter(snake, action));
+		if (!snake.isFree(next)) {
+			continue;
+		}
+		int dist = std::abs(next.first - snake.candy.first) + std::abs(next.second - snake.candy.second);
+		if (best_dist == -1 || dist < best_dist) {
+			best = action;
+			best_dist = dist;
+		}
+	}
+	return best;
+}
+
+std::unique_ptr<Agent> createAgent(const std::string& name) {
+	if (name == "random") {
+		return std::make_unique<RandomAgent>();
+	}
+	if (name == "greedy") {
+		return std::make_unique<GreedyAgent>();
+	}
+	if (name == "autopilot") {
+		return std::make_unique<AutopilotAgent>();
+	}
+	if (name == "hamilton") {
+		return std::make_unique<HamiltonAgent>();
+	}
+	if (name == "mcts") {
+		return std::make_unique<MctsAgent>();
+	}
+	return nullptr;
+}
@@ -0,0 +1,49 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Snake.h"
+#include "Rng.h"
+
+// Something that plays the game instead of the keyboard
+class Agent {
+public:
+	virtual ~Agent() = default;
+
+	// Called once before every new game with its board and the game's
+	// seed and stream, so agents that roll dice stay reproducible too.
+	// Agents size whatever they keep for the board here, so that
+	// decide() doesn't allocate once the game has started.
+	virtual void reset(BoardSize /* board */, uint64_t /* seed */, uint64_t /* stream */) {}
+
+	// Called once per tick, before Snake::moveOneStep, on the board
+	// given to the last reset()
+	virtual Action decide(const Snake& snake) = 0;
+};
+
+// Picks uniformly among the moves that don't kill the snake right away
+class RandomAgent : public Agent {
+private:
+	Rng rng;
+
+public:
+	void reset(BoardSize board, uint64_t seed, uint64_t stream) override;
+	Action decide(const Snake& snake) override;
+};
+
+// Heads straight for the candy, avoiding only immediate collisions
+class GreedyAgent : public Agent {
+public:
+	Action decide(const Snake& snake) override;
+};
+
+// Orientation the snake faces once it has made action
+int orientationAfter(const Snake& snake, Action action);
+
+// Returns nullptr for unknown names
+std::unique_ptr<Agent> createAgent(const std::string& name);
+
+#endif
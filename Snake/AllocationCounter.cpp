@@ -0,0 +1,58 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<long long> allocations(0);
+static thread_local long long thread_allocations = 0;
+
+static inline void count() {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	thread_allocations++;
+}
+
+long long allocationCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+long long threadAllocationCount() {
+	return thread_allocations;
+}
+
+void* operator new(std::size_t size) {
+	count();
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	count();
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
@@ -0,0 +1,16 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+/************************************************************************
+*	Counts heap allocations by replacing the global operator new. Only	*
+*	programs that compile AllocationCounter.cpp in count them, the		*
+*	game itself keeps the standard one.									*
+************************************************************************/
+
+// Allocations made so far by the whole program
+long long allocationCount();
+
+// Allocations made so far by the calling thread
+long long threadAllocationCount();
+
+#endif
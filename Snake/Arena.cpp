@@ -0,0 +1,18 @@
+#include "Arena.h"
+
+#include <cstdint>
+#include <new>
+
+Arena::Arena(std::size_t bytes) : buffer(std::make_unique_for_overwrite<std::byte[]>(bytes)), capacity(bytes), used(0) {
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+	// aligned as an address, the buffer itself only is to the default
+	uintptr_t base = (uintptr_t) buffer.get();
+	std::size_t start = (std::size_t) (((base + used + alignment - 1) & ~(uintptr_t) (alignment - 1)) - base);
+	if (start > capacity || bytes > capacity - start) {
+		throw std::bad_alloc();
+	}
+	used = start + bytes;
+	return buffer.get() + start;
+}
@@ -0,0 +1,57 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+/************************************************************************
+*	One block of memory for everything a game keeps, taken from the		*
+*	heap once when the game is created. Containers draw their storage	*
+*	from it through std::pmr and a bump pointer hands it out; nothing	*
+*	is given back before the arena goes away. Running past its end		*
+*	throws std::bad_alloc instead of falling back to the heap, so a		*
+*	buffer that would grow mid-game shows up the first time it tries.	*
+************************************************************************/
+class Arena : public std::pmr::memory_resource {
+private:
+	std::unique_ptr<std::byte[]> buffer;
+	std::size_t capacity;
+	std::size_t used;
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+	void do_deallocate(void*, std::size_t, std::size_t) override {
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+
+public:
+	explicit Arena(std::size_t bytes);
+
+	Arena(const Arena&) = delete;
+
+	// Keeps its own memory: containers assigned from another game copy
+	// their contents into the storage they already have here
+	Arena& operator=(const Arena&) {
+		return *this;
+	}
+
+	inline std::size_t size() const {
+		return capacity;
+	}
+
+	inline std::size_t bytesUsed() const {
+		return used;
+	}
+
+	// Room for count objects of type T, wherever they end up aligned
+	template <class T>
+	static constexpr std::size_t bytesFor(std::size_t count) {
+		return count * sizeof(T) + alignof(T) - 1;
+	}
+};
+
+#endif
@@ -0,0 +1,298 @@
+#include "Autopilot.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+static const Action ACTIONS[3] = { Action::STRAIGHT, Action::LEFT, Action::RIGHT };
+
+// While following the tail, ticks between two searches for a safe path
+// to the candy
+static const int RETRY_TICKS = 4;
+
+AutopilotAgent::AutopilotAgent() : width(0), height(0), stride(0), current_body(0), current_search(0),
+	path_next(0), path_candy(-1), expected_head(-1), route_next(0), route_len(0), current_route(0), stalled(0) {
+}
+
+void AutopilotAgent::reset(BoardSize board, uint64_t, uint64_t) {
+	if (board.width != width || board.height != height) {
+		resize(board);
+	}
+	path.clear();
+	path_candy = -1;
+	route.clear();
+	stalled = 0;
+}
+
+void AutopilotAgent::resize(BoardSize size) {
+	width = size.width;
+	height = size.height;
+	stride = width + 2;
+	int count = (height + 2) * stride;
+	border.assign(count, 1);
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			border[cellOf(x, y)] = 0;
+		}
+	}
+	free_after.assign(count, 0);
+	body_epoch.assign(count, 0);
+	current_body = 0;
+	distance.assign(count, 0);
+	parent.assign(count, -1);
+	seen.assign(count, 0);
+	current_search = 0;
+	queue.resize(count);
+	// a body and a path over the whole board
+	cells.reserve(2 * (std::size_t) count + 1);
+	path.reserve(count);
+	path.clear();
+	path_candy = -1;
+	route.reserve(count);
+	route.clear();
+	link.assign(count, 0);
+	on_route.assign(count, 0);
+	current_route = 0;
+}
+
+void AutopilotAgent::loadBody(const Snake& snake) {
+	const Body& body = snake.getBody();
+	cells.clear();
+	for (int i = body.size() - 1; i >= 0; i--) {
+		cells.push_back(cellOf(body.at(i).x, body.at(i).y));
+	}
+}
+
+void AutopilotAgent::stampBody(int length) {
+	current_body++;
+	if (current_body == 0) {
+		// wrapped around, old stamps could look current again
+		std::fill(body_epoch.begin(), body_epoch.end(), 0);
+		current_body = 1;
+	}
+	int first = (int) cells.size() - length;
+	for (int i = 0; i < length; i++) {
+		// the tail can be entered on the next tick, the head last
+		int cell = cells[first + i];
+		free_after[cell] = i + 1;
+		body_epoch[cell] = current_body;
+	}
+}
+
+int AutopilotAgent::search(int start, int target, int& reached) {
+	current_search++;
+	if (current_search == 0) {
+		std::fill(seen.begin(), seen.end(), 0);
+		current_search = 1;
+	}
+	const int offsets[4] = { -stride, 1, stride, -1 };
+	int first = 0;
+	int last = 0;
+	queue[last++] = start;
+	seen[start] = current_search;
+	distance[start] = 0;
+	reached = 1;
+	while (first < last) {
+		int cell = queue[first++];
+		int next_distance = distance[cell] + 1;
+		for (int offset : offsets) {
+			int next = cell + offset;
+			if (seen[next] == current_search || border[next] ||
+				(body_epoch[next] == current_body && next_distance < free_after[next])) {
+				continue;
+			}
+			seen[next] = current_search;
+			distance[next] = next_distance;
+			parent[next] = cell;
+			if (next == target) {
+				return next_distance;
+			}
+			queue[last++] = next;
+			reached++;
+		}
+	}
+	return -1;
+}
+
+void AutopilotAgent::takePath(int start, int cell) {
+	path.clear();
+	for (; cell != start; cell = parent[cell]) {
+		path.push_back(cell);
+	}
+	std::reverse(path.begin(), path.end());
+}
+
+bool AutopilotAgent::planRoute(int head, int tail, int length) {
+	// the route keeps off the body, even where it would have moved on in
+	// time: such a cell would be body again when the head gets to the old
+	// tail, in the way of the cells the tail has freed since. Off the body
+	// the route stays safe with a candy eaten on it, the tail only waits
+	for (int i = (int) cells.size() - length + 1; i < (int) cells.size(); i++) {
+		free_after[cells[i]] = std::numeric_limits<int>::max();
+	}
+	int reached;
+	if (search(head, tail, reached) < 0) {
+		return false;
+	}
+	current_route++;
+	if (current_route == 0) {
+		std::fill(on_route.begin(), on_route.end(), 0);
+		current_route = 1;
+	}
+	on_route[head] = current_route;
+	for (int cell = tail; cell != head; cell = parent[cell]) {
+		link[parent[cell]] = cell;
+		on_route[cell] = current_route;
+	}
+
+	// wherever the two cells beside a step are free, go round through
+	// them, so the snake leaves no holes behind
+	int cell = head;
+	while (cell != tail) {
+		int next = link[cell];
+		int side = next - cell == 1 || next - cell == -1 ? stride : 1;
+		if (!isOpen(cell + side) || !isOpen(next + side)) {
+			side = -side;
+			if (!isOpen(cell + side) || !isOpen(next + side)) {
+				cell = next;
+				continue;
+			}
+		}
+		link[cell] = cell + side;
+		link[cell + side] = next + side;
+		link[next + side] = next;
+		on_route[cell + side] = current_route;
+		on_route[next + side] = current_route;
+	}
+
+	route.clear();
+	for (cell = link[head]; cell != tail; cell = link[cell]) {
+		route.push_back(cell);
+	}
+	route.push_back(tail);
+	route_next = 0;
+	route_len = length;
+	return true;
+}
+
+bool AutopilotAgent::pathIsSafe(const Snake& snake) {
+	int length = snake.len + 1;
+	if (length == width * height) {
+		return true; // that candy wins the game
+	}
+	cells.insert(cells.end(), path.begin(), path.end());
+	stampBody(length);
+	int reached;
+	return search(path.back(), cells[cells.size() - length], reached) >= 0;
+}
+
+Action AutopilotAgent::followTail(const Snake& snake, int candy) {
+	std::pair<int, int> head = snake.getHead();
+	loadBody(snake);
+	int tail = cells.front();
+
+	// after a full lap decide() takes any path to the candy there is, so
+	// the body walls it off and the route would only go round the same
+	// way again: moves are picked one by one instead; a snake of two
+	// would go back into its tail
+	if (snake.len > 2 && stalled <= width * height) {
+		stampBody(snake.len);
+		if (planRoute(cellOf(head.first, head.second), tail, snake.len)) {
+			expected_head = route[route_next++];
+			return towards(snake, expected_head);
+		}
+	}
+
+	// the longest way back to the tail, or if there is none the most room
+	Action best = Action::STRAIGHT;
+	bool best_safe = false;
+	int best_score = -1;
+	for (Action action : ACTIONS) {
+		int orientation = orientationAfter(snake, action);
+		std::pair<int, int> next = Snake::step(head, orientation);
+		int cell = cellOf(next.first, next.second);
+		// the tail moves out of the way, unless the candy is eaten
+		if (border[cell] || (!snake.isFree(next) && cell != tail)) {
+			continue;
+		}
+		int length = snake.len + (cell == candy);
+		if (length == width * height) {
+			return action;
+		}
+		cells.push_back(cell);
+		stampBody(length);
+		int reached;
+		int way = search(cell, cells[cells.size() - length], reached);
+		cells.pop_back();
+		bool safe = way >= 0;
+		int score = safe ? way : reached;
+		if (safe && stalled > width * height) {
+			// going round the same loop, the candy never gets a safe path:
+			// keep the tail in reach but head for the candy instead
+			score = -std::abs(next.first - snake.candy.first) - std::abs(next.second - snake.candy.second);
+		}
+		if ((safe && !best_safe) || (safe == best_safe && score > best_score)) {
+			best = action;
+			best_safe = safe;
+			best_score = score;
+		}
+	}
+	return best;
+}
+
+Action AutopilotAgent::towards(const Snake& snake, int cell) const {
+	const int offsets[4] = { -stride, 1, stride, -1 };
+	std::pair<int, int> head = snake.getHead();
+	int head_cell = cellOf(head.first, head.second);
+	for (Action action : ACTIONS) {
+		if (head_cell + offsets[orientationAfter(snake, action)] == cell) {
+			return action;
+		}
+	}
+	return Action::STRAIGHT;
+}
+
+Action AutopilotAgent::decide(const Snake& snake) {
+	std::pair<int, int> head = snake.getHead();
+	int head_cell = cellOf(head.first, head.second);
+	int candy = snake.candy.first >= 0 ? cellOf(snake.candy.first, snake.candy.second) : -1;
+
+	// still on the way to the same candy
+	bool on_path = head_cell == expected_head;
+	if (on_path && candy >= 0 && candy == path_candy && path_next < path.size()) {
+		expected_head = path[path_next++];
+		return towards(snake, expected_head);
+	}
+	// or round to the tail; after a candy eaten on the way the tail waits
+	// a tick, which the route can take once but not twice
+	bool on_route = on_path && path_candy < 0 && route_next < route.size() && snake.len <= route_len + 1;
+
+	path.clear();
+	path_candy = -1;
+	// following the tail the body hardly changes from one tick to the next
+	if (candy >= 0 && stalled % RETRY_TICKS == 0) {
+		loadBody(snake);
+		stampBody(snake.len);
+		int reached;
+		if (search(head_cell, candy, reached) > 0) {
+			takePath(head_cell, candy);
+			// a whole lap round without a safe path is a loop the snake
+			// would only go on with until the game is cut short, so the
+			// path is risked
+			if (pathIsSafe(snake) || stalled > width * height) {
+				stalled = 0;
+				route.clear();
+				path_candy = candy;
+				path_next = 1;
+				expected_head = path[0];
+				return towards(snake, expected_head);
+			}
+		}
+	}
+	stalled++;
+	if (on_route) {
+		expected_head = route[route_next++];
+		return towards(snake, expected_head);
+	}
+	return followTail(snake, candy);
+}
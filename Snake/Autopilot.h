@@ -0,0 +1,114 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Agent.h"
+
+/************************************************************************
+*	Steers along a shortest path to the candy, found breadth-first.		*
+*	A cell of the body counts as free from the tick the tail has left	*
+*	it on, so paths may run where the snake lies now. A path is only	*
+*	taken if, once the candy is eaten at its end, the head could still	*
+*	reach the tail; otherwise the snake follows its tail the long way	*
+*	round until a safe path opens up.									*
+*																		*
+*	The path is kept and followed one cell per tick for as long as the	*
+*	candy stays and the head moves along it, since nothing else can		*
+*	block it: the snake doesn't grow before the candy and the tail		*
+*	leaves the cells the way the search expected. The way round to the	*
+*	tail is planned once and kept the same way: a shortest path to the	*
+*	tail over free cells, stretched with detours over free cells next	*
+*	to it, so the snake coils up instead of leaving holes. It stays		*
+*	good with a candy eaten on it, since the tail then only waits a		*
+*	tick. While following it, a path to the candy is looked for every	*
+*	few ticks; searches only run then, when a candy is eaten or when	*
+*	the snake leaves its path. After a whole lap without a safe path	*
+*	the snake is going round in a loop and risks the path it has.		*
+*																		*
+*	The distance fields themselves aren't updated incrementally: each	*
+*	search is a full breadth-first pass over the board, since a move	*
+*	changes when every body cell frees up. Caching only makes them		*
+*	rare. A decision costs about 0.2 us for a short snake and 0.6 us	*
+*	at length 512 on 40x20, against 1.9 us with a search every tick.	*
+************************************************************************/
+class AutopilotAgent : public Agent {
+private:
+	// Cells are numbered on the board with a border around it, so the
+	// four neighbours of a cell are a fixed offset away
+	int width;
+	int height;
+	int stride;
+	std::vector<uint8_t> border;
+
+	// ticks from now until a cell of the body can be entered, for the
+	// cells stamped with the current epoch; every other cell is free
+	std::vector<int> free_after;
+	std::vector<uint32_t> body_epoch;
+	uint32_t current_body;
+
+	// breadth-first search, seen is stamped the same way
+	std::vector<int> distance;
+	std::vector<int> parent;
+	std::vector<uint32_t> seen;
+	uint32_t current_search;
+	std::vector<int> queue;
+
+	// cells of a body, from the tail to the head and then on along a
+	// path, to see where the snake ends up
+	std::vector<int> cells;
+
+	// the path being followed, head excluded and the candy last
+	std::vector<int> path;
+	std::size_t path_next;
+	int path_candy;
+	int expected_head; // where the head is after the last move handed out
+
+	// the way round to the tail, tail last; link chains its cells while
+	// it is being stretched, on_route is stamped with current_route
+	std::vector<int> route;
+	std::size_t route_next;
+	int route_len; // length of the snake it was planned for
+	std::vector<int> link;
+	std::vector<uint32_t> on_route;
+	uint32_t current_route;
+	int stalled; // ticks spent following the tail since the last path taken
+
+	inline int cellOf(int x, int y) const {
+		return (x + 1) * stride + (y + 1);
+	}
+
+	void resize(BoardSize size);
+	// Puts the cells of the snake into cells
+	void loadBody(const Snake& snake);
+	// Takes the last length entries of cells as the body
+	void stampBody(int length);
+	// Shortest path length from start to target (-1 if there is none)
+	// with every cell blocked until it is free; reached counts the cells
+	// the search got to
+	int search(int start, int target, int& reached);
+	// Replaces path with the way the last search found from start to
+	// cell, start left out
+	void takePath(int start, int cell);
+	// Plans route from the head to the tail of the body stamped last,
+	// over free cells only; false if the tail can't be reached that way
+	bool planRoute(int head, int tail, int length);
+	// A free cell that is not on the route being planned
+	inline bool isOpen(int cell) const {
+		return !border[cell] && body_epoch[cell] != current_body && on_route[cell] != current_route;
+	}
+	// Whether the snake, on the path in path, can reach its tail once
+	// it has eaten the candy at the end of it
+	bool pathIsSafe(const Snake& snake);
+	Action followTail(const Snake& snake, int candy);
+	Action towards(const Snake& snake, int cell) const;
+
+public:
+	AutopilotAgent();
+
+	void reset(BoardSize board, uint64_t seed, uint64_t stream) override;
+	Action decide(const Snake& snake) override;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "Body.h"
+#include "Arena.h"
+
+#include <cstring>
+#include <algorithm>
+
+// Ring slots for a snake of max_length cells
+static unsigned int ringCapacity(int max_length) {
+	unsigned int capacity = 1;
+	while (capacity < (unsigned int) max_length) {
+		capacity <<= 1;
+	}
+	return capacity;
+}
+
+Body::Body(int max_length, std::pmr::memory_resource* memory) : ring(memory), colors(memory) {
+	unsigned int capacity = ringCapacity(max_length);
+	ring.resize(capacity);
+	mask = capacity - 1;
+	colors.resize(capacity);
+	clear();
+}
+
+std::size_t Body::arenaBytes(int max_length) {
+	unsigned int capacity = ringCapacity(max_length);
+	return Arena::bytesFor<Cell>(capacity) + Arena::bytesFor<uint8_t>(capacity);
+}
+
+// count ring slots from first on, wrapping around the end of the ring
+template <class T>
+static void copyOut(const std::pmr::vector<T>& ring, unsigned int first, int count, std::byte*& out) {
+	std::size_t part = std::min<std::size_t>((std::size_t) count, ring.size() - first);
+	std::memcpy(out, ring.data() + first, part * sizeof(T));
+	std::memcpy(out + part * sizeof(T), ring.data(), (count - part) * sizeof(T));
+	out += count * sizeof(T);
+}
+
+template <class T>
+static void copyIn(std::pmr::vector<T>& ring, unsigned int first, int count, const std::byte*& in) {
+	std::size_t part = std::min<std::size_t>((std::size_t) count, ring.size() - first);
+	std::memcpy(ring.data() + first, in, part * sizeof(T));
+	std::memcpy(ring.data(), in + part * sizeof(T), (count - part) * sizeof(T));
+	in += count * sizeof(T);
+}
+
+std::size_t Body::snapshotBytes(int max_length) {
+	return sizeof(head) + sizeof(length) + ringCapacity(max_length) * (sizeof(Cell) + sizeof(uint8_t));
+}
+
+void Body::save(std::byte*& out) const {
+	std::memcpy(out, &head, sizeof(head));
+	std::memcpy(out + sizeof(head), &length, sizeof(length));
+	out += sizeof(head) + sizeof(length);
+	unsigned int first = (head + 1 - (unsigned int) length) & mask;
+	copyOut(ring, first, length, out);
+	copyOut(colors, first, length, out);
+}
+
+void Body::load(const std::byte*& in) {
+	std::memcpy(&head, in, sizeof(head));
+	std::memcpy(&length, in + sizeof(head), sizeof(length));
+	in += sizeof(head) + sizeof(length);
+	unsigned int first = (head + 1 - (unsigned int) length) & mask;
+	copyIn(ring, first, length, in);
+	copyIn(colors, first, length, in);
+}
+
+void Body::clear() {
+	head = mask;
+	length = 0;
+}
+
+void Body::pushHead(int x, int y, int dir) {
+	head = (head + 1) & mask;
+	ring[head] = Cell{ (int16_t) x, (int16_t) y, (uint8_t) dir };
+	length++;
+}
+
+void Body::popTail() {
+	length--;
+}
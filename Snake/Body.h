@@ -0,0 +1,97 @@
+#ifndef BODY_H
+#define BODY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory_resource>
+
+
+/************************************************************************
+*	Cells taken by the snake, stored in a ring buffer from the tail		*
+*	to the head. A tick only writes a new head and (unless the snake	*
+*	grows) drops the tail, so it costs the same for any length.			*
+************************************************************************/
+class Body {
+public:
+	struct Cell {
+		int16_t x;
+		int16_t y;
+		uint8_t dir; // orientation of the move that entered this cell
+	};
+
+private:
+	std::pmr::vector<Cell> ring;
+	unsigned int mask;
+	unsigned int head; // ring index of the head
+	int length;
+
+	// palette color of the segment in each ring slot; a cell keeps its
+	// color for as long as the snake lies on it
+	std::pmr::vector<uint8_t> colors;
+
+public:
+	Body(int max_length, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// What the constructor takes from memory
+	static std::size_t arenaBytes(int max_length);
+
+	// Most bytes save() writes
+	static std::size_t snapshotBytes(int max_length);
+
+	// Writes the cells the snake lies on to out and moves out past them
+	void save(std::byte*& out) const;
+
+	// Reads what save() wrote on a body of the same size back into the
+	// same ring slots
+	void load(const std::byte*& in);
+
+	void clear();
+
+	void pushHead(int x, int y, int dir);
+
+	void popTail();
+
+	// 0 is the head, size() - 1 the tail
+	inline const Cell& at(int i) const {
+		return ring[(head - (unsigned int) i) & mask];
+	}
+
+	inline const Cell& front() const {
+		return at(0);
+	}
+
+	inline const Cell& back() const {
+		return at(length - 1);
+	}
+
+	inline int size() const {
+		return length;
+	}
+
+	// Palette color of the body segment at index i (1 <= i < size() - 1)
+	inline uint8_t segmentColor(int i) const {
+		return colors[(head - (unsigned int) i) & mask];
+	}
+
+	inline void setSegmentColor(int i, uint8_t color) {
+		colors[(head - (unsigned int) i) & mask] = color;
+	}
+
+	// Ring slot of the head; a cell's slot stays the same while the
+	// snake lies on it, indexOf() turns it back into a body index
+	inline unsigned int headSlot() const {
+		return head;
+	}
+
+	inline unsigned int slotOf(int i) const {
+		return (head - (unsigned int) i) & mask;
+	}
+
+	inline int indexOf(unsigned int slot) const {
+		return (int) ((head - slot) & mask);
+	}
+};
+
+#endif
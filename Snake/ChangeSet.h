@@ -0,0 +1,64 @@
+#ifndef CHANGE_SET_H
+#define CHANGE_SET_H
+
+#include <utility>
+
+/************************************************************************
+*	Cells whose picture changed since the last frame. A tick adds only	*
+*	a handful (head, neck, tail, candy); when more pile up than fit,	*
+*	or after a restart, the whole board counts as changed.				*
+************************************************************************/
+class ChangeSet {
+public:
+	static const int MAX_CELLS = 32;
+
+private:
+	std::pair<int, int> cells[MAX_CELLS];
+	int count;
+	bool all;
+
+public:
+	ChangeSet() {
+		markAll();
+	}
+
+	inline void markAll() {
+		all = true;
+		count = 0;
+	}
+
+	inline void mark(int x, int y) {
+		if (all) {
+			return;
+		}
+		for (int i = 0; i < count; i++) {
+			if (cells[i].first == x && cells[i].second == y) {
+				return;
+			}
+		}
+		if (count == MAX_CELLS) {
+			markAll();
+			return;
+		}
+		cells[count++] = std::pair<int, int>(x, y);
+	}
+
+	inline void clear() {
+		all = false;
+		count = 0;
+	}
+
+	inline bool isAll() const {
+		return all;
+	}
+
+	inline int size() const {
+		return count;
+	}
+
+	inline const std::pair<int, int>& at(int i) const {
+		return cells[i];
+	}
+};
+
+#endif
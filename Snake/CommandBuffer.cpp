@@ -0,0 +1,95 @@
+#include "CommandBuffer.h"
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+CommandBuffer::CommandBuffer(int capacity, std::pmr::memory_resource* memory) : commands(memory), sorted(memory),
+	run_colors(memory), bucket_start(DRAW_KIND_COUNT * PALETTE_SIZE + 1, memory) {
+	commands.reserve(capacity);
+	sorted.reserve(capacity);
+	run_colors.reserve(capacity);
+}
+
+std::size_t CommandBuffer::arenaBytes(int capacity) {
+	return 2 * Arena::bytesFor<RenderCommand>(capacity) + Arena::bytesFor<Color>(capacity) +
+		Arena::bytesFor<int>(DRAW_KIND_COUNT * PALETTE_SIZE + 1);
+}
+
+void CommandBuffer::clear(const ChangeSet& changed) {
+	commands.clear();
+	run_colors.clear();
+	dirty = changed;
+}
+
+void CommandBuffer::sortByBatch() {
+	std::fill(bucket_start.begin(), bucket_start.end(), 0);
+	for (const RenderCommand& command : commands) {
+		bucket_start[command.kind * PALETTE_SIZE + command.color + 1]++;
+	}
+	for (size_t i = 1; i < bucket_start.size(); i++) {
+		bucket_start[i] += bucket_start[i - 1];
+	}
+	sorted.resize(commands.size());
+	for (const RenderCommand& command : commands) {
+		sorted[bucket_start[command.kind * PALETTE_SIZE + command.color]++] = command;
+	}
+	commands.swap(sorted);
+}
+
+int CommandBuffer::issue(const RenderCommand& command, RenderSink* sink) const {
+	Color color = paletteColor(command.color);
+	switch (command.kind) {
+	case DRAW_STRAIGHT_RUN:
+		return sink->drawStraightRun(command.x, command.y, command.orientation, command.length, runColors(command));
+	case DRAW_CURVED:
+		return sink->drawCurvedSegment(command.x, command.y, command.orientation, color);
+	case DRAW_HEAD:
+		return sink->drawHead(command.x, command.y, command.orientation);
+	case DRAW_TAIL:
+		return sink->drawTail(command.x, command.y, command.orientation);
+	case DRAW_EATING_ANIMATION:
+		return sink->drawEatingAnimation(command.x, command.y, command.orientation, color);
+	case DRAW_CANDY:
+		return sink->drawCandy(command.x, command.y, color);
+	}
+	return 1;
+}
+
+int CommandBuffer::replay(RenderSink* sink) const {
+	for (const RenderCommand& command : commands) {
+		if (issue(command, sink)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int CommandBuffer::replayAround(RenderSink* sink, const std::pair<int, int>& cell) const {
+	for (const RenderCommand& command : commands) {
+		// every command covers a line of cells, most of them just one
+		int last_x = command.x + ORIENTATION_DX[command.orientation] * (command.length - 1);
+		int last_y = command.y + ORIENTATION_DY[command.orientation] * (command.length - 1);
+		if (std::min<int>(command.x, last_x) > cell.first + 1 || std::max<int>(command.x, last_x) < cell.first - 1 ||
+			std::min<int>(command.y, last_y) > cell.second + 1 || std::max<int>(command.y, last_y) < cell.second - 1) {
+			continue;
+		}
+		if (issue(command, sink)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int RenderSink::drawStraightRun(int x, int y, int orientation, int length, const Color* colors) {
+	for (int i = 0; i < length; i++) {
+		if (drawStraightSegment(x + ORIENTATION_DX[orientation] * i, y + ORIENTATION_DY[orientation] * i, orientation, colors[i])) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int RenderSink::drawCommands(CommandBuffer& commands) {
+	return commands.replay(this);
+}
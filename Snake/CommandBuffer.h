@@ -0,0 +1,116 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+#include "RenderSink.h"
+#include "Palette.h"
+#include "ChangeSet.h"
+
+// One RenderSink call each, in the order they are layered on screen
+enum DrawKind {
+	DRAW_STRAIGHT_RUN,
+	DRAW_CURVED,
+	DRAW_HEAD,
+	DRAW_TAIL,
+	DRAW_EATING_ANIMATION,
+	DRAW_CANDY,
+	DRAW_KIND_COUNT
+};
+
+struct RenderCommand {
+	uint8_t kind;
+	uint8_t orientation;
+	uint8_t color; // palette index, not used by the head, the tail and runs
+	int16_t x;
+	int16_t y;
+	// straight runs only: cells in the run and where their colors start
+	// in CommandBuffer::runColors()
+	uint16_t length;
+	uint32_t colors;
+};
+
+// Step from a cell to the next one in each orientation
+const int ORIENTATION_DX[4] = { -1, 0, 1, 0 };
+const int ORIENTATION_DY[4] = { 0, 1, 0, -1 };
+
+/************************************************************************
+*	Everything one frame draws, recorded by Snake::draw and handed to	*
+*	RenderSink::drawCommands in one piece. A backend that pays for		*
+*	every change of brush can sortByBatch() first: commands of one		*
+*	kind and color then follow each other, kinds still in layer order.	*
+*																		*
+*	A frame either covers the whole board or only repaints the dirty	*
+*	cells over the previous frame; then it holds just the commands		*
+*	that reach into those cells.										*
+*																		*
+*	Straight segments come in runs: one command covers every cell		*
+*	between two bends, however long, with the colors kept aside.		*
+************************************************************************/
+class CommandBuffer {
+private:
+	std::pmr::vector<RenderCommand> commands;
+	std::pmr::vector<RenderCommand> sorted;
+	std::pmr::vector<Color> run_colors;
+	std::pmr::vector<int> bucket_start;
+	ChangeSet dirty;
+
+	int issue(const RenderCommand& command, RenderSink* sink) const;
+
+public:
+	// capacity commands and as many run cells fit without allocating
+	CommandBuffer(int capacity, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// What the constructor takes from memory
+	static std::size_t arenaBytes(int capacity);
+
+	// Starts a frame that repaints the cells in changed (or everything)
+	void clear(const ChangeSet& changed);
+
+	inline const ChangeSet& getDirty() const {
+		return dirty;
+	}
+
+	inline void record(DrawKind kind, int x, int y, int orientation, uint8_t color) {
+		commands.push_back(RenderCommand{ (uint8_t) kind, (uint8_t) orientation, color, (int16_t) x, (int16_t) y, 1, 0 });
+	}
+
+	// Starts an empty straight run at (x, y); extendRun() adds its cells
+	// one by one in the given orientation
+	inline void beginRun(int x, int y, int orientation) {
+		commands.push_back(RenderCommand{
+			DRAW_STRAIGHT_RUN, (uint8_t) orientation, 0, (int16_t) x, (int16_t) y, 0, (uint32_t) run_colors.size()
+		});
+	}
+
+	inline void extendRun(uint8_t color) {
+		run_colors.push_back(paletteColor(color));
+		commands.back().length++;
+	}
+
+	inline const Color* runColors(const RenderCommand& command) const {
+		return run_colors.data() + command.colors;
+	}
+
+	// Stable counting sort on (kind, color)
+	void sortByBatch();
+
+	inline int size() const {
+		return (int) commands.size();
+	}
+
+	inline const RenderCommand& at(int i) const {
+		return commands[i];
+	}
+
+	// Issues the commands one by one through the single-shape calls
+	int replay(RenderSink* sink) const;
+
+	// Same, but only for commands on the cell or the eight around it
+	int replayAround(RenderSink* sink, const std::pair<int, int>& cell) const;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Game rules shared by the engine and every frontend.
+// Nothing in here may depend on a platform header.
+
+// Board used when nothing else is asked for
+const int GRID_WIDTH = 40;
+const int GRID_HEIGHT = 20;
+
+// Board size in cells, chosen at runtime
+struct BoardSize {
+	int width;
+	int height;
+};
+
+const BoardSize DEFAULT_BOARD = { GRID_WIDTH, GRID_HEIGHT };
+
+// Seconds between two game ticks
+const float SPEED = (float) 0.4;
+
+#endif
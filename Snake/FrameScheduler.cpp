@@ -0,0 +1,35 @@
+#include "FrameScheduler.h"
+
+FrameScheduler::FrameScheduler(float seconds_per_tick, int max_catch_up) {
+	tick_length = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(seconds_per_tick));
+	if (tick_length <= Clock::duration::zero()) {
+		tick_length = Clock::duration(1);
+	}
+	this->max_catch_up = max_catch_up;
+	start(Clock::now());
+}
+
+void FrameScheduler::start(Clock::time_point now) {
+	next_tick = now + tick_length;
+}
+
+int FrameScheduler::ticksDue(Clock::time_point now) {
+	if (now < next_tick) {
+		return 0;
+	}
+	long long due = (now - next_tick) / tick_length + 1;
+	if (due > max_catch_up) {
+		// too far behind, run what we may and pick up the schedule from here
+		next_tick = now + tick_length;
+		return max_catch_up;
+	}
+	next_tick += tick_length * due;
+	return (int) due;
+}
+
+FrameScheduler::Clock::duration FrameScheduler::timeUntilNextTick(Clock::time_point now) const {
+	if (now >= next_tick) {
+		return Clock::duration::zero();
+	}
+	return next_tick - now;
+}
@@ -0,0 +1,34 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <chrono>
+
+/************************************************************************
+*	Fixed-timestep clock for game ticks. Ticks are due at start + n *	*
+*	tick length on a monotonic clock, so late wake-ups don't shift the	*
+*	ones after them. After a stall the missed ticks are run back to		*
+*	back, up to max_catch_up of them; anything older is dropped.		*
+************************************************************************/
+class FrameScheduler {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	Clock::duration tick_length;
+	Clock::time_point next_tick;
+	int max_catch_up;
+
+public:
+	FrameScheduler(float seconds_per_tick, int max_catch_up = 5);
+
+	// The first tick becomes due one tick length after now
+	void start(Clock::time_point now);
+
+	// How many ticks to run now; each call consumes them
+	int ticksDue(Clock::time_point now);
+
+	// Zero when a tick is already due
+	Clock::duration timeUntilNextTick(Clock::time_point now) const;
+};
+
+#endif
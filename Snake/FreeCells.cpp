@@ -0,0 +1,67 @@
+#include "FreeCells.h"
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+FreeCells::FreeCells(int size, std::pmr::memory_resource* memory) : cells(memory), position(memory),
+	cells_epoch(memory), position_epoch(memory) {
+	cells.resize(size);
+	position.resize(size);
+	cells_epoch.resize(size, 0);
+	position_epoch.resize(size, 0);
+	epoch = 0;
+	fill();
+}
+
+std::size_t FreeCells::arenaBytes(int size) {
+	return 2 * Arena::bytesFor<int>(size) + 2 * Arena::bytesFor<uint32_t>(size);
+}
+
+std::size_t FreeCells::snapshotBytes(int size) {
+	return sizeof(epoch) + sizeof(count) + (std::size_t) size * (2 * sizeof(int) + 2 * sizeof(uint32_t));
+}
+
+// Appends the elements of values to out
+template <class T>
+static void copyOut(const std::pmr::vector<T>& values, std::byte*& out) {
+	std::memcpy(out, values.data(), values.size() * sizeof(T));
+	out += values.size() * sizeof(T);
+}
+
+template <class T>
+static void copyIn(std::pmr::vector<T>& values, const std::byte*& in) {
+	std::memcpy(values.data(), in, values.size() * sizeof(T));
+	in += values.size() * sizeof(T);
+}
+
+void FreeCells::save(std::byte*& out) const {
+	std::memcpy(out, &epoch, sizeof(epoch));
+	std::memcpy(out + sizeof(epoch), &count, sizeof(count));
+	out += sizeof(epoch) + sizeof(count);
+	copyOut(cells, out);
+	copyOut(position, out);
+	copyOut(cells_epoch, out);
+	copyOut(position_epoch, out);
+}
+
+void FreeCells::load(const std::byte*& in) {
+	std::memcpy(&epoch, in, sizeof(epoch));
+	std::memcpy(&count, in + sizeof(epoch), sizeof(count));
+	in += sizeof(epoch) + sizeof(count);
+	copyIn(cells, in);
+	copyIn(position, in);
+	copyIn(cells_epoch, in);
+	copyIn(position_epoch, in);
+}
+
+void FreeCells::fill() {
+	epoch++;
+	if (epoch == 0) {
+		// wrapped around, old stamps could look current again
+		std::fill(cells_epoch.begin(), cells_epoch.end(), 0);
+		std::fill(position_epoch.begin(), position_epoch.end(), 0);
+		epoch = 1;
+	}
+	count = (int) cells.size();
+}
@@ -0,0 +1,123 @@
+#ifndef FREE_CELLS_H
+#define FREE_CELLS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+/************************************************************************
+*	Set of free cells that can hand out a uniformly random member in	*
+*	O(1). cells is a permutation of all cell ids with the free ones		*
+*	packed at the front; position is its inverse. Taking a cell swaps	*
+*	it with the last free one, freeing it swaps it back in.				*
+*																		*
+*	Entries are stamped with the epoch they were written in. An entry	*
+*	from an older epoch reads as the identity, so fill() only has to	*
+*	bump the epoch instead of rewriting both arrays.					*
+************************************************************************/
+class FreeCells {
+private:
+	std::pmr::vector<int> cells;
+	std::pmr::vector<int> position;
+	std::pmr::vector<uint32_t> cells_epoch;
+	std::pmr::vector<uint32_t> position_epoch;
+	uint32_t epoch;
+	int count;
+
+	inline int cellAt(int i) const {
+		return cells_epoch[i] == epoch ? cells[i] : i;
+	}
+
+	inline int positionOf(int cell) const {
+		return position_epoch[cell] == epoch ? position[cell] : cell;
+	}
+
+	inline void swap(int i, int j) {
+		int a = cellAt(i);
+		int b = cellAt(j);
+		cells[i] = b;
+		cells[j] = a;
+		position[b] = i;
+		position[a] = j;
+		cells_epoch[i] = epoch;
+		cells_epoch[j] = epoch;
+		position_epoch[a] = epoch;
+		position_epoch[b] = epoch;
+	}
+
+public:
+	FreeCells(int size, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// What the constructor takes from memory
+	static std::size_t arenaBytes(int size);
+
+	// Bytes save() writes
+	static std::size_t snapshotBytes(int size);
+
+	// Writes the set as it is kept, stamps and all, to out and moves out
+	// past it; copying is quicker than putting the stamps right again
+	void save(std::byte*& out) const;
+
+	// Reads what save() wrote on a set of the same size
+	void load(const std::byte*& in);
+
+	// Marks every cell as free
+	void fill();
+
+	// Puts back a state read with at() and size(): next() hands out
+	// every cell id in that order, the first free_count of them free
+	template <class Next>
+	void restore(int free_count, Next next) {
+		fill();
+		for (int i = 0; i < (int) cells.size(); i++) {
+			int cell = next();
+			cells[i] = cell;
+			position[cell] = i;
+			cells_epoch[i] = epoch;
+			position_epoch[cell] = epoch;
+		}
+		count = free_count;
+	}
+
+	// Whether what restore() put back is a permutation: no cell id twice,
+	// so every one is kept where its position says
+	inline bool isPermutation() const {
+		for (int i = 0; i < (int) cells.size(); i++) {
+			if (positionOf(cellAt(i)) != i) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline void remove(int cell) {
+		count--;
+		swap(positionOf(cell), count);
+	}
+
+	inline void add(int cell) {
+		swap(positionOf(cell), count);
+		count++;
+	}
+
+	inline bool contains(int cell) const {
+		return positionOf(cell) < count;
+	}
+
+	inline int size() const {
+		return count;
+	}
+
+	// i-th free cell, 0 <= i < size(); up to capacity() the taken
+	// ones follow in the order they are kept in
+	inline int at(int i) const {
+		return cellAt(i);
+	}
+
+	inline int capacity() const {
+		return (int) cells.size();
+	}
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Grid.h"
+#include "Arena.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+// Words for a board of w x h cells and its border
+static std::size_t wordCount(int w, int h) {
+	return ((std::size_t) (h + 2) * (w + 2) + 63) / 64;
+}
+
+Grid::Grid(int w, int h, std::pmr::memory_resource* memory) : words(memory), empty_words(memory) {
+	width = w;
+	height = h;
+	stride = w + 2;
+	// the bits past the last row stay taken
+	words.assign(wordCount(w, h), ~(uint64_t) 0);
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			release(x, y);
+		}
+	}
+	empty_words = words;
+}
+
+std::size_t Grid::arenaBytes(int w, int h) {
+	return 2 * Arena::bytesFor<uint64_t>(wordCount(w, h));
+}
+
+std::size_t Grid::snapshotBytes(int w, int h) {
+	return wordCount(w, h) * sizeof(uint64_t);
+}
+
+void Grid::save(std::byte*& out) const {
+	std::memcpy(out, words.data(), words.size() * sizeof(uint64_t));
+	out += words.size() * sizeof(uint64_t);
+}
+
+void Grid::load(const std::byte*& in) {
+	std::memcpy(words.data(), in, words.size() * sizeof(uint64_t));
+	in += words.size() * sizeof(uint64_t);
+}
+
+void Grid::clear() {
+	std::copy(empty_words.begin(), empty_words.end(), words.begin());
+}
+
+int Grid::countTakenBits(int begin, int end) const {
+	int count = 0;
+	while (begin < end) {
+		int offset = begin & 63;
+		int bits = 64 - offset;
+		if (bits > end - begin) {
+			bits = end - begin;
+		}
+		uint64_t mask = bits == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << bits) - 1) << offset;
+		count += std::popcount(words[begin >> 6] & mask);
+		begin += bits;
+	}
+	return count;
+}
+
+int Grid::countFree() const {
+	int taken = 0;
+	for (uint64_t word : words) {
+		taken += std::popcount(word);
+	}
+	return (int) words.size() * 64 - taken;
+}
+
+int Grid::countFreeInRect(int x0, int y0, int x1, int y1) const {
+	int count = 0;
+	for (int x = x0; x < x1; x++) {
+		count += (y1 - y0) - countTakenBits(index(x, y0), index(x, y1));
+	}
+	return count;
+}
+
+void Grid::findFree(int k, int& x, int& y) const {
+	for (std::size_t w = 0; w < words.size(); w++) {
+		uint64_t free_bits = ~words[w];
+		int count = std::popcount(free_bits);
+		if (k >= count) {
+			k -= count;
+			continue;
+		}
+		for (; k > 0; k--) {
+			free_bits &= free_bits - 1; // drop the lowest free cell
+		}
+		int i = (int) w * 64 + std::countr_zero(free_bits);
+		x = i / stride - 1;
+		y = i % stride - 1;
+		return;
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+
+/************************************************************************
+*	Bit-packed occupancy of the board, one bit per cell (1 = taken).	*
+*	The board is surrounded by a border of permanently taken cells,		*
+*	so a cell one step outside the board needs no separate check.		*
+*	Rows are stored back to back, width + 2 bits each.					*
+************************************************************************/
+class Grid {
+private:
+	int width;
+	int height;
+	int stride;
+	std::pmr::vector<uint64_t> words;
+	std::pmr::vector<uint64_t> empty_words; // just the border, copied by clear()
+
+	int countTakenBits(int begin, int end) const;
+
+public:
+	Grid(int w, int h, std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+	// What the constructor takes from memory
+	static std::size_t arenaBytes(int w, int h);
+
+	// Bytes save() writes
+	static std::size_t snapshotBytes(int w, int h);
+
+	// Writes the occupancy to out and moves out past it
+	void save(std::byte*& out) const;
+
+	// Reads what save() wrote on a grid of the same size
+	void load(const std::byte*& in);
+
+	// Frees the whole board, costs one copy of (w + 2) * (h + 2) bits
+	void clear();
+
+	// Bit index of a cell; x may be -1..height and y -1..width.
+	// W is the board width when it is known at compile time, 0 if not.
+	template <int W = 0>
+	inline int index(int x, int y) const {
+		return (x + 1) * (W ? W + 2 : stride) + (y + 1);
+	}
+
+	template <int W = 0>
+	inline bool isOccupied(int x, int y) const {
+		int i = index<W>(x, y);
+		return (words[i >> 6] >> (i & 63)) & 1;
+	}
+
+	template <int W = 0>
+	inline void occupy(int x, int y) {
+		int i = index<W>(x, y);
+		words[i >> 6] |= (uint64_t) 1 << (i & 63);
+	}
+
+	template <int W = 0>
+	inline void release(int x, int y) {
+		int i = index<W>(x, y);
+		words[i >> 6] &= ~((uint64_t) 1 << (i & 63));
+	}
+
+	int countFree() const;
+
+	// Free cells in rows [x0, x1) and columns [y0, y1)
+	int countFreeInRect(int x0, int y0, int x1, int y1) const;
+
+	// Finds the k-th free cell in row-major order, k < countFree()
+	void findFree(int k, int& x, int& y) const;
+};
+
+#endif
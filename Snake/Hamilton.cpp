@@ -0,0 +1,255 @@
+#include "Hamilton.h"
+
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+static const Action ACTIONS[3] = { Action::STRAIGHT, Action::LEFT, Action::RIGHT };
+
+static const char CYCLE_MAGIC[4] = { 'S', 'N', 'K', 'C' };
+static const std::size_t CYCLE_HEADER = 16;
+
+static std::filesystem::path cycle_directory = ".";
+
+static uint32_t getLe32(const uint8_t* p) {
+	return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static void putLe32(std::vector<uint8_t>& bytes, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		bytes.push_back((uint8_t) (value >> 8 * i));
+	}
+}
+
+HamiltonCycle::HamiltonCycle() : width(0), height(0), table(nullptr) {
+}
+
+bool HamiltonCycle::exists(BoardSize size) {
+	return size.width >= 2 && size.height >= 2 && (size.width % 2 == 0 || size.height % 2 == 0);
+}
+
+std::filesystem::path HamiltonCycle::cachePath(const std::filesystem::path& directory, BoardSize size) {
+	return directory / ("cycle-" + std::to_string(size.width) + "x" + std::to_string(size.height) + ".snkc");
+}
+
+bool HamiltonCycle::isValid() const {
+	int n = cells();
+	std::vector<int> cell_at(n, -1);
+	for (int cell = 0; cell < n; cell++) {
+		uint32_t i = table[cell];
+		if (i >= (uint32_t) n || cell_at[i] != -1) {
+			return false;
+		}
+		cell_at[i] = cell;
+	}
+	// tail and head of a new game first, so following it never runs into the body
+	if (cell_at[0] != 0 || cell_at[1] != 1) {
+		return false;
+	}
+	for (int i = 0; i < n; i++) {
+		int a = cell_at[i];
+		int b = cell_at[(i + 1) % n];
+		if (std::abs(a / width - b / width) + std::abs(a % width - b % width) != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int HamiltonCycle::build(BoardSize size) {
+	if (!exists(size)) {
+		return 1;
+	}
+	width = size.width;
+	height = size.height;
+	file.close();
+	built.assign(cells(), 0);
+	uint32_t next = 0;
+	auto visit = [&](int x, int y) {
+		built[x * width + y] = next++;
+	};
+	for (int y = 0; y < width; y++) {
+		visit(0, y);
+	}
+	if (width % 2 == 0) {
+		// down and up the columns from the right, ending next to (0, 0)
+		for (int y = width - 1; y >= 0; y--) {
+			bool down = (width - 1 - y) % 2 == 0;
+			for (int i = 1; i < height; i++) {
+				visit(down ? i : height - i, y);
+			}
+		}
+	}
+	else {
+		// along the rows right of the first column, then up the first column
+		for (int x = 1; x < height; x++) {
+			bool left = x % 2 == 1;
+			for (int i = 1; i < width; i++) {
+				visit(x, left ? width - i : i);
+			}
+		}
+		for (int x = height - 1; x >= 1; x--) {
+			visit(x, 0);
+		}
+	}
+	table = built.data();
+	return 0;
+}
+
+int HamiltonCycle::load(const std::filesystem::path& path, BoardSize size) {
+	if (!exists(size)) {
+		return 1;
+	}
+	MappedFile mapped;
+	if (mapped.open(path)) {
+		return 1;
+	}
+	const uint8_t* data = mapped.data();
+	std::size_t n = (std::size_t) size.width * size.height;
+	if (mapped.size() != CYCLE_HEADER + 4 * n || std::memcmp(data, CYCLE_MAGIC, 4) != 0 ||
+		getLe32(data + 4) != CYCLE_VERSION || getLe32(data + 8) != (uint32_t) size.width ||
+		getLe32(data + 12) != (uint32_t) size.height) {
+		return 1;
+	}
+
+	// checked before this cycle gives up the one it has
+	HamiltonCycle loaded;
+	loaded.width = size.width;
+	loaded.height = size.height;
+	if (std::endian::native == std::endian::little) {
+		// the mapping is page aligned, so the entries are too
+		loaded.table = (const uint32_t*) (data + CYCLE_HEADER);
+	}
+	else {
+		loaded.built.resize(n);
+		for (std::size_t i = 0; i < n; i++) {
+			loaded.built[i] = getLe32(data + CYCLE_HEADER + 4 * i);
+		}
+		loaded.table = loaded.built.data();
+	}
+	if (!loaded.isValid()) {
+		return 1;
+	}
+
+	width = size.width;
+	height = size.height;
+	built.swap(loaded.built);
+	table = built.empty() ? loaded.table : built.data();
+	file.swap(mapped);
+	return 0;
+}
+
+int HamiltonCycle::save(const std::filesystem::path& path) const {
+	if (table == nullptr) {
+		return 1;
+	}
+	std::vector<uint8_t> bytes(CYCLE_MAGIC, CYCLE_MAGIC + 4);
+	putLe32(bytes, CYCLE_VERSION);
+	putLe32(bytes, (uint32_t) width);
+	putLe32(bytes, (uint32_t) height);
+	for (int cell = 0; cell < cells(); cell++) {
+		putLe32(bytes, table[cell]);
+	}
+
+	// other processes and threads may be writing the same table
+	std::filesystem::path temporary = path;
+	temporary += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+		"-" + std::to_string((uintptr_t) this);
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			return 1;
+		}
+		out.write((const char*) bytes.data(), (std::streamsize) bytes.size());
+		if (!out.good()) {
+			out.close();
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			return 1;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return 1;
+	}
+	return 0;
+}
+
+int HamiltonCycle::open(const std::filesystem::path& directory, BoardSize size) {
+	if (!exists(size)) {
+		return 1;
+	}
+	std::filesystem::path path = cachePath(directory, size);
+	if (load(path, size) == 0) {
+		return 0;
+	}
+	build(size);
+	// if another writer got there first its table is just as good
+	save(path);
+	load(path, size);
+	return 0;
+}
+
+void setCycleDirectory(const std::filesystem::path& directory) {
+	cycle_directory = directory;
+}
+
+HamiltonAgent::HamiltonAgent() : board{ 0, 0 }, has_cycle(false) {
+}
+
+void HamiltonAgent::reset(BoardSize size, uint64_t seed, uint64_t stream) {
+	// the table may have to be built and saved, which is no work for a tick
+	if (size.width != board.width || size.height != board.height) {
+		board = size;
+		has_cycle = cycle.open(cycle_directory, size) == 0;
+	}
+	fallback.reset(size, seed, stream);
+}
+
+Action HamiltonAgent::decide(const Snake& snake) {
+	if (!has_cycle) {
+		return fallback.decide(snake);
+	}
+
+	std::pair<int, int> head = snake.getHead();
+	const Body::Cell& tail = snake.getBody().back();
+	int head_cell = head.first * board.width + head.second;
+	int tail_cell = tail.x * board.width + tail.y;
+	int to_tail = ahead(head_cell, tail_cell);
+	// the candy may also sit in a gap a corner cut left inside the body,
+	// then it is only reached once the tail has gone past it
+	int to_candy = snake.candy.first >= 0 ? ahead(head_cell, snake.candy.first * board.width + snake.candy.second) : -1;
+	bool candy_ahead = to_candy > 0 && to_candy < to_tail;
+	// those gaps cost a lap whenever a candy lands in one, and once the
+	// snake covers half the board that is more than cutting saves
+	bool cut_corners = snake.len * 2 < cycle.cells();
+
+	Action best = Action::STRAIGHT;
+	int best_ahead = 0;
+	for (Action action : ACTIONS) {
+		std::pair<int, int> next = Snake::step(head, orientationAfter(snake, action));
+		bool is_tail = next.first == tail.x && next.second == tail.y;
+		if (!snake.isFree(next) && !is_tail) {
+			continue;
+		}
+		int steps = ahead(head_cell, next.first * board.width + next.second);
+		// past the tail, or past the candy, which would then take a lap
+		if (steps > to_tail || (candy_ahead && steps > to_candy) || (!cut_corners && steps > 1)) {
+			continue;
+		}
+		if (steps > best_ahead) {
+			best = action;
+			best_ahead = steps;
+		}
+	}
+	// only when something else steered the snake off the cycle
+	if (best_ahead == 0) {
+		return fallback.decide(snake);
+	}
+	return best;
+}
@@ -0,0 +1,106 @@
+#ifndef HAMILTON_H
+#define HAMILTON_H
+
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+#include "Agent.h"
+#include "Autopilot.h"
+#include "MappedFile.h"
+
+const uint32_t CYCLE_VERSION = 1;
+
+/************************************************************************
+*	A Hamiltonian cycle of the board: order() numbers the cells in the	*
+*	order the cycle visits them, starting at (0, 0) and going on to		*
+*	(0, 1), where a new game puts the tail and the head. Boards with	*
+*	an odd number of cells or a side of one cell have none.				*
+*																		*
+*	Tables are kept on disk, one file per board size, and read through	*
+*	a memory mapping. The file is "SNKC", version, width, height and	*
+*	then order() of every cell in cell id order, all 32-bit little		*
+*	endian numbers.														*
+************************************************************************/
+class HamiltonCycle {
+private:
+	int width;
+	int height;
+	MappedFile file;
+	std::vector<uint32_t> built; // when the table isn't mapped
+	const uint32_t* table;
+
+	// Whether table is a cycle of the board that starts like a game
+	bool isValid() const;
+
+public:
+	HamiltonCycle();
+
+	HamiltonCycle(const HamiltonCycle&) = delete;
+	HamiltonCycle& operator=(const HamiltonCycle&) = delete;
+
+	static bool exists(BoardSize size);
+
+	// Where the table of the board is kept in directory
+	static std::filesystem::path cachePath(const std::filesystem::path& directory, BoardSize size);
+
+	// Maps the table of the board from directory, building it and saving
+	// it there first if it isn't there or isn't right. If it can't be
+	// saved the built table is used from memory. 1 if the board has no
+	// cycle.
+	int open(const std::filesystem::path& directory, BoardSize size);
+
+	// Builds the table in memory: a serpentine over the rows, back along
+	// the first column (over the columns and back along the first row if
+	// the number of rows is odd)
+	int build(BoardSize size);
+
+	int load(const std::filesystem::path& path, BoardSize size);
+
+	// Writes the table, through a temporary file so a reader never sees
+	// half of it
+	int save(const std::filesystem::path& path) const;
+
+	inline uint32_t order(int cell) const {
+		return table[cell];
+	}
+
+	inline int cells() const {
+		return width * height;
+	}
+};
+
+// Where HamiltonAgent keeps the cycle tables, the working directory
+// unless set
+void setCycleDirectory(const std::filesystem::path& directory);
+
+/************************************************************************
+*	Follows a Hamiltonian cycle, so it never dies and fills the board.	*
+*	Cutting a corner is allowed as long as the head lands between		*
+*	itself and the tail along the cycle, and no further than the		*
+*	candy: the body then still lies in cycle order behind the head,		*
+*	and the cells ahead up to the tail stay free. Once the snake covers	*
+*	half the board it sticks to the cycle. On boards without a cycle	*
+*	it plays as the autopilot.											*
+************************************************************************/
+class HamiltonAgent : public Agent {
+private:
+	HamiltonCycle cycle;
+	BoardSize board;
+	bool has_cycle;
+	AutopilotAgent fallback;
+
+	// How far ahead along the cycle to is from from
+	inline int ahead(int from, int to) const {
+		int n = cycle.cells();
+		return (int) ((cycle.order(to) + n - cycle.order(from)) % n);
+	}
+
+public:
+	HamiltonAgent();
+
+	void reset(BoardSize board, uint64_t seed, uint64_t stream) override;
+	Action decide(const Snake& snake) override;
+};
+
+#endif
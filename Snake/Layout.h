@@ -0,0 +1,22 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "Config.h"
+
+// Window layout shared by every renderer, in pixels
+
+const int WIN_WIDTH = 1200;
+const int WIN_HEIGHT = 620;
+const int MARGIN = 20;
+
+const float FONT_SIZE = 50.0f;
+const float BOARDER_WIDTH = 5.0f;
+
+// Side of one (square) cell when the board fills the window
+inline int cellSize(BoardSize board) {
+	int width = (WIN_WIDTH - 2 * MARGIN) / board.width;
+	int height = (WIN_HEIGHT - 2 * MARGIN) / board.height;
+	return width < height ? width : height;
+}
+
+#endif
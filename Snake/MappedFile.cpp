@@ -0,0 +1,120 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+}
+
+int MappedFile::open(const std::filesystem::path& path) {
+	close();
+	file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_RANDOM_ACCESS, nullptr);
+	LARGE_INTEGER file_size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size)) {
+		close();
+		return 1;
+	}
+	if (file_size.QuadPart == 0) {
+		return 0; // can't map nothing
+	}
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping != nullptr) {
+		bytes = (const uint8_t*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (bytes == nullptr) {
+		close();
+		return 1;
+	}
+	length = (std::size_t) file_size.QuadPart;
+	return 0;
+}
+
+void MappedFile::advise(std::size_t, std::size_t, Access) const {
+	// a view takes no such hints; the file was opened for random access
+	// and the cache manager reads ahead of sequential reads by itself
+}
+
+void MappedFile::close() {
+	if (bytes != nullptr) {
+		UnmapViewOfFile(bytes);
+	}
+	if (mapping != nullptr) {
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	bytes = nullptr;
+	length = 0;
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), file(-1) {
+}
+
+int MappedFile::open(const std::filesystem::path& path) {
+	close();
+	file = ::open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) != 0) {
+		close();
+		return 1;
+	}
+	if (status.st_size == 0) {
+		return 0; // can't map nothing
+	}
+	void* mapped = mmap(nullptr, (std::size_t) status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	if (mapped == MAP_FAILED) {
+		close();
+		return 1;
+	}
+	bytes = (const uint8_t*) mapped;
+	length = (std::size_t) status.st_size;
+	return 0;
+}
+
+void MappedFile::advise(std::size_t offset, std::size_t size, Access access) const {
+	if (bytes == nullptr || offset >= length) {
+		return;
+	}
+	size = std::min(size, length - offset);
+	// from the start of the page, the mapping itself starts on one
+	std::size_t page = (std::size_t) sysconf(_SC_PAGESIZE);
+	std::size_t start = offset / page * page;
+	madvise((void*) (bytes + start), offset + size - start, access == Access::RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+}
+
+void MappedFile::close() {
+	if (bytes != nullptr) {
+		munmap((void*) bytes, length);
+	}
+	if (file >= 0) {
+		::close(file);
+	}
+	bytes = nullptr;
+	length = 0;
+	file = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
@@ -0,0 +1,67 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <utility>
+
+// A whole file mapped read-only into memory: its bytes are read straight
+// from the page cache, nothing is copied and only the pages touched are
+// ever loaded
+class MappedFile {
+public:
+	// How bytes of the file are about to be read
+	enum class Access {
+		RANDOM, // a few pages at a time, from anywhere
+		SEQUENTIAL // front to back
+	};
+
+private:
+	const uint8_t* bytes;
+	std::size_t length;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// 1 if the file can't be opened or mapped; an empty file maps to no bytes
+	int open(const std::filesystem::path& path);
+
+	void close();
+
+	// Tells the system how bytes [offset, offset + size) will be read, so
+	// it reads ahead of them only as far as that pays. Only a hint: the
+	// bytes read the same either way.
+	void advise(std::size_t offset, std::size_t size, Access access) const;
+
+	// Trades mappings with other, so a file can be checked before it
+	// replaces the one in use
+	inline void swap(MappedFile& other) {
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+		std::swap(file, other.file);
+#ifdef _WIN32
+		std::swap(mapping, other.mapping);
+#endif
+	}
+
+	inline const uint8_t* data() const {
+		return bytes;
+	}
+
+	inline std::size_t size() const {
+		return length;
+	}
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "Mcts.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+
+static const Action ACTIONS[3] = { Action::STRAIGHT, Action::LEFT, Action::RIGHT };
+
+// Nodes in the pool, 24 bytes each
+static const int32_t MCTS_NODES = 1 << 19;
+// Deepest walk down the tree; deeper moves are left to the playout
+static const int MAX_DEPTH = 512;
+// Iterations between two looks at the clock
+static const int CLOCK_BATCH = 16;
+// Weight of trying moves again against playing the best one, for
+// rewards between 0 and 1
+static const double EXPLORATION = 0.7;
+// Worth of a candy one tick later than another; without it eating now
+// and eating some time are the same and the snake circles forever
+static const double DISCOUNT = 0.9;
+
+static MctsSettings mcts_settings;
+
+void setMctsSettings(const MctsSettings& settings) {
+	mcts_settings = settings;
+}
+
+MctsAgent::MctsAgent() : MctsAgent(mcts_settings) {
+}
+
+MctsAgent::MctsAgent(const MctsSettings& s) : settings(s), pool(s.threads), node_count(0), board{ 0, 0 },
+	seed(0), stream(0), moves(0), last_playouts(0) {
+	workers.resize(pool.threadCount());
+}
+
+void MctsAgent::reset(BoardSize size, uint64_t game_seed, uint64_t game_stream) {
+	// the pool and the games the workers play on are only made here, so
+	// a move doesn't allocate
+	if (nodes == nullptr) {
+		nodes = std::make_unique<Node[]>(MCTS_NODES);
+	}
+	if (size.width != board.width || size.height != board.height) {
+		board = size;
+		root = std::make_unique<SnakeSnapshot>(size);
+		for (Worker& worker : workers) {
+			worker.game = std::make_unique<Snake>(nullptr, size, 0);
+			worker.path.reserve(MAX_DEPTH);
+		}
+	}
+	seed = game_seed;
+	stream = game_stream;
+	moves = 0;
+}
+
+int32_t MctsAgent::newNode() {
+	// checked first, so the counter stays put once the pool is full
+	if (node_count.load(std::memory_order_relaxed) >= MCTS_NODES) {
+		return 0;
+	}
+	int32_t index = node_count.fetch_add(1, std::memory_order_relaxed);
+	if (index >= MCTS_NODES) {
+		return 0;
+	}
+	Node& node = nodes[index];
+	for (std::atomic<int32_t>& child : node.children) {
+		child.store(0, std::memory_order_relaxed);
+	}
+	node.visits.store(0, std::memory_order_relaxed);
+	node.reward.store(0.0, std::memory_order_relaxed);
+	return index;
+}
+
+void MctsAgent::play(Worker& worker, Action action) {
+	Snake& game = *worker.game;
+	int len = game.len;
+	game.turn(action);
+	game.moveOneStep();
+	worker.ticks++;
+	if (game.len > len && worker.eaten == 0.0) {
+		worker.eaten = std::pow(DISCOUNT, worker.ticks);
+	}
+}
+
+double MctsAgent::playout(Worker& worker) {
+	Snake& game = *worker.game;
+	int ticks = board.width + board.height; // enough to reach any candy
+	while (game.running && ticks-- > 0) {
+		// mostly the greedy move, sometimes any move that doesn't die
+		std::pair<int, int> head = game.getHead();
+		Action safe[3];
+		int count = 0;
+		Action closest = Action::STRAIGHT;
+		int closest_dist = -1;
+		for (Action action : ACTIONS) {
+			std::pair<int, int> next = Snake::step(head, orientationAfter(game, action));
+			if (!game.isFree(next)) {
+				continue;
+			}
+			safe[count++] = action;
+			int dist = std::abs(next.first - game.candy.first) + std::abs(next.second - game.candy.second);
+			if (closest_dist == -1 || dist < closest_dist) {
+				closest = action;
+				closest_dist = dist;
+			}
+		}
+		if (count > 1 && worker.rng.below(4) == 0) {
+			closest = safe[worker.rng.below(count)];
+		}
+		play(worker, closest);
+	}
+	if (game.game_end == GameEnd::WON) {
+		return 1.0;
+	}
+	return (game.running ? 0.4 : 0.0) + 0.6 * worker.eaten;
+}
+
+void MctsAgent::iterate(Worker& worker) {
+	Snake& game = *worker.game;
+	game.restore(*root);
+	worker.path.clear();
+	worker.ticks = 0;
+	worker.eaten = 0.0;
+	int32_t node = 0;
+	nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+	worker.path.push_back(0);
+
+	while (game.running && (int) worker.path.size() < MAX_DEPTH) {
+		Node& current = nodes[node];
+		double log_visits = std::log((double) current.visits.load(std::memory_order_relaxed));
+		std::pair<int, int> head = game.getHead();
+		int best = -1;
+		int32_t best_child = 0;
+		double best_score = -1.0;
+		for (int a = 0; a < 3; a++) {
+			// moves that die right away are never worth a node; trying
+			// them would only make every cell next to a wall look deadly
+			if (!game.isFree(Snake::step(head, orientationAfter(game, (Action) a)))) {
+				continue;
+			}
+			int32_t child = current.children[a].load(std::memory_order_acquire);
+			if (child == 0) {
+				// moves not tried yet come first
+				best = a;
+				best_child = 0;
+				break;
+			}
+			int visits = nodes[child].visits.load(std::memory_order_relaxed);
+			double score = std::numeric_limits<double>::infinity();
+			if (visits > 0) {
+				score = nodes[child].reward.load(std::memory_order_relaxed) / visits +
+					EXPLORATION * std::sqrt(log_visits / visits);
+			}
+			if (score > best_score) {
+				best = a;
+				best_child = child;
+				best_score = score;
+			}
+		}
+
+		if (best == -1) {
+			break; // the playout will find out the snake is trapped
+		}
+		play(worker, (Action) best);
+
+		bool added = false;
+		if (best_child == 0) {
+			best_child = newNode();
+			if (best_child == 0) {
+				break; // the pool is full, play out from here
+			}
+			int32_t expected = 0;
+			if (!current.children[best].compare_exchange_strong(expected, best_child, std::memory_order_acq_rel)) {
+				// another worker added it first; the node taken here is lost
+				best_child = expected;
+			}
+			added = true;
+		}
+		// the virtual loss, until the reward is added below
+		nodes[best_child].visits.fetch_add(1, std::memory_order_relaxed);
+		worker.path.push_back(best_child);
+		node = best_child;
+		if (added) {
+			break;
+		}
+	}
+
+	double reward = playout(worker);
+	for (int32_t visited : worker.path) {
+		nodes[visited].reward.fetch_add(reward, std::memory_order_relaxed);
+	}
+}
+
+Action MctsAgent::decide(const Snake& snake) {
+	snake.snapshot(*root);
+	node_count.store(0, std::memory_order_relaxed);
+	newNode();
+	for (int w = 0; w < (int) workers.size(); w++) {
+		// the playouts of every move and worker roll their own dice
+		workers[w].rng.reseed(seed + moves * workers.size() + w, ~stream);
+		workers[w].playouts = 0;
+	}
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(settings.budget);
+	pool.parallelFor(pool.threadCount(), [&](int64_t, int w) {
+		Worker& worker = workers[w];
+		do {
+			for (int i = 0; i < CLOCK_BATCH; i++) {
+				iterate(worker);
+			}
+			worker.playouts += CLOCK_BATCH;
+		} while (std::chrono::steady_clock::now() < deadline);
+	});
+	moves++;
+
+	last_playouts = 0;
+	for (const Worker& worker : workers) {
+		last_playouts += worker.playouts;
+	}
+	Action best = Action::STRAIGHT;
+	int best_visits = -1;
+	for (int a = 0; a < 3; a++) {
+		int32_t child = nodes[0].children[a].load(std::memory_order_relaxed);
+		int visits = child != 0 ? nodes[child].visits.load(std::memory_order_relaxed) : 0;
+		if (visits > best_visits) {
+			best = (Action) a;
+			best_visits = visits;
+		}
+	}
+	return best;
+}
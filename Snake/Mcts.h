@@ -0,0 +1,94 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "Agent.h"
+#include "Config.h"
+#include "Rng.h"
+#include "TaskScheduler.h"
+
+// Share of a tick the search may take; the rest is left to run and draw it
+const float MCTS_BUDGET_SHARE = (float) 0.75;
+
+struct MctsSettings {
+	float budget = SPEED * MCTS_BUDGET_SHARE; // seconds of search per move
+	int threads = 0; // 0 means one per hardware thread
+};
+
+// What createAgent("mcts") gives its agents; set before creating them
+void setMctsSettings(const MctsSettings& settings);
+
+/************************************************************************
+*	Monte Carlo tree search over the three moves of every tick. Each	*
+*	worker of the agent's own TaskScheduler restores the current game	*
+*	into a headless game of its own, walks down the tree by UCT, adds	*
+*	a node and plays the game out with a quick policy, until the time	*
+*	budget is spent. The snake's Rng is part of the game, so the		*
+*	candies a playout meets are the ones the game will place.			*
+*																		*
+*	The tree is shared without locks: nodes come from one preallocated	*
+*	pool through an atomic counter, a child is published with a CAS		*
+*	and visits and rewards are atomic sums. A worker counts its visit	*
+*	on the way down and adds the reward on the way back, so until then	*
+*	the visit is a loss (virtual loss) and the other workers spread		*
+*	over other moves. Once the pool is full the search goes on without	*
+*	growing the tree. The move played is the most visited one.			*
+************************************************************************/
+class MctsAgent : public Agent {
+private:
+	struct Node {
+		std::atomic<int32_t> children[3]; // by Action, 0 until added
+		std::atomic<int32_t> visits; // virtual losses included
+		std::atomic<double> reward; // sum over the finished visits
+	};
+
+	// What a worker plays out its moves on
+	struct alignas(64) Worker {
+		std::unique_ptr<Snake> game;
+		Rng rng;
+		std::vector<int32_t> path; // nodes of the current walk, root first
+		int ticks; // played since the root
+		double eaten; // candies eaten since the root, discounted by when
+		long long playouts;
+	};
+
+	MctsSettings settings;
+	TaskScheduler pool;
+	std::unique_ptr<Node[]> nodes;
+	std::atomic<int32_t> node_count;
+	std::vector<Worker> workers;
+	std::unique_ptr<SnakeSnapshot> root;
+	BoardSize board;
+	uint64_t seed;
+	uint64_t stream;
+	uint64_t moves; // decided in this game
+	long long last_playouts;
+
+	// Index of a fresh node, 0 once the pool is full
+	int32_t newNode();
+	// One walk down the tree, playout and update
+	void iterate(Worker& worker);
+	// Moves worker's game on by one tick
+	void play(Worker& worker, Action action);
+	// Plays on with the quick policy; the reward of where it ends up
+	double playout(Worker& worker);
+
+public:
+	// With the settings given to setMctsSettings
+	MctsAgent();
+	explicit MctsAgent(const MctsSettings& settings);
+
+	void reset(BoardSize board, uint64_t seed, uint64_t stream) override;
+	Action decide(const Snake& snake) override;
+
+	// Playouts run by the last decide(), over all workers
+	inline long long playoutsLastMove() const {
+		return last_playouts;
+	}
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "Paint.h"
 
+#include <algorithm>
+
 using D2D1::RenderTargetProperties;
 using D2D1::HwndRenderTargetProperties;
 using D2D1::SizeU;
@@ -28,7 +30,7 @@ HRESULT Paint::createRectangleFromWindow(HWND& hwnd) {
 }
 
 HRESULT Paint::createRenderTarget(HWND& hwnd) {
-    return d2d_factory->CreateHwndRenderTarget(
+    HRESULT hr = d2d_factory->CreateHwndRenderTarget(
         RenderTargetProperties(),
         HwndRenderTargetProperties(
             hwnd,
@@ -37,10 +39,14 @@ HRESULT Paint::createRenderTarget(HWND& hwnd) {
                 static_cast<UINT32>(rc.left),
                 static_cast<UINT32>(rc.bottom) -
                 static_cast<UINT32>(rc.top)
-            )
+            ),
+            // later frames only repaint what changed over this one
+            D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS
         ),
         &d2d_render_target
     );
+    target = d2d_render_target;
+    return hr;
 }
 
 HRESULT Paint::createBrush() {
@@ -82,6 +88,14 @@ HRESULT Paint::createLinearBrush() {
 }
 
 void Paint::DiscardRenderDeviceResources() {
+    frame_kept = false;
+    discardLayers();
+    for (int pass = 0; pass < 2; pass++) {
+        if (run_brushes[pass]) run_brushes[pass]->Release();
+        if (run_strips[pass]) run_strips[pass]->Release();
+        run_brushes[pass] = nullptr;
+        run_strips[pass] = nullptr;
+    }
     if (lin_brush) lin_brush->Release();
     if (myBrush) myBrush->Release();
     if (pLogoBitmap) pLogoBitmap->Release();
@@ -93,6 +107,7 @@ int Paint::CreateRenderDeviceResources(HWND& hwnd) {
     if (FAILED(createRenderTarget(hwnd)) ||
         FAILED(createBrush()) ||
         FAILED(createLinearBrush()) ||
+        FAILED(createRunStrips()) ||
         FAILED(createBitmaps())) {
         return 1;
     }
@@ -106,15 +121,24 @@ void Paint::freeResources() {
     if (write_factory) write_factory->Release();
     if (text_format) text_format->Release();
     if (pIWICFactory) pIWICFactory->Release();
-    if (straightSegment) straightSegment->Release();
-    if (curvedSegment) curvedSegment->Release();
-    if (headSegment) headSegment->Release();
-    if (tailSegment) tailSegment->Release();
-    if (eatingParticleSegment) eatingParticleSegment->Release();
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        if (shape_paths[shape]) shape_paths[shape]->Release();
+        for (int orientation = 0; orientation < 4; orientation++) {
+            if (shape_cache[shape][orientation]) shape_cache[shape][orientation]->Release();
+        }
+    }
+    for (ID2D1PathGeometry* path : run_paths) {
+        if (path) path->Release();
+    }
+    for (int orientation = 0; orientation < 4; orientation++) {
+        for (ID2D1TransformedGeometry* geometry : run_cache[orientation]) {
+            if (geometry) geometry->Release();
+        }
+    }
 }
 
 void Paint::setBackground(D2D1::ColorF color) {
-    d2d_render_target->Clear(color);
+    target->Clear(color);
 }
 
 
@@ -157,7 +181,7 @@ HRESULT Paint::createTextFormat() {
 
 void Paint::writeText(const WCHAR* text, D2D1::ColorF col, UINT32 len, float x, float y) {
     lin_brush->SetOpacity(0.2f);
-    d2d_render_target->DrawText(
+    target->DrawText(
         text,
         len,
         text_format,
@@ -169,7 +193,7 @@ void Paint::writeText(const WCHAR* text, D2D1::ColorF col, UINT32 len, float x,
         lin_brush
     );
     myBrush->SetColor(col);
-    d2d_render_target->DrawText(
+    target->DrawText(
         text,
         len,
         text_format,
@@ -267,7 +291,7 @@ HRESULT Paint::createBitmap(LPCWSTR file_name, ID2D1Bitmap** ptr) {
 }
 
 void Paint::drawBgBitmap() {
-    d2d_render_target->DrawBitmap(
+    target->DrawBitmap(
         pBgBitmap,
         D2D1::RectF(0, 0, WIN_WIDTH, WIN_HEIGHT),
         1.0f,
@@ -276,7 +300,7 @@ void Paint::drawBgBitmap() {
 }
 
 void Paint::drawLogo() {
-    d2d_render_target->DrawBitmap(
+    target->DrawBitmap(
         pLogoBitmap,
         D2D1::RectF(WIN_WIDTH / 2, WIN_HEIGHT / 2, WIN_WIDTH, WIN_HEIGHT),
         1.0f,
@@ -284,60 +308,41 @@ void Paint::drawLogo() {
     );
 }
 
-HRESULT Paint::createStraightSegment() {
-    HRESULT hr = d2d_factory->CreatePathGeometry(&straightSegment);
+// Every command ending above the center of the shape box, with the start
+// if it is up there too, is moved stretch further up
+HRESULT Paint::createPath(const ShapePath& path, float stretch, ID2D1PathGeometry** geometry) {
+    HRESULT hr = d2d_factory->CreatePathGeometry(geometry);
     if (FAILED(hr)) {
         return hr;
     }
 
     // Open a sink to write to the path geometry.
     ID2D1GeometrySink* geometry_sink = nullptr;
-    hr = straightSegment->Open(&geometry_sink);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    geometry_sink->BeginFigure({ 300.00f , 300.00f }, D2D1_FIGURE_BEGIN_FILLED);
-    geometry_sink->AddLine({ 300.00f , 400.00f });
-    geometry_sink->AddBezier({ { 333.00 , 450.00 }, { 367.00 , 350.00 }, { 400.00 , 400.00 } });
-    geometry_sink->AddLine({ 400.00 , 300.00 });
-    geometry_sink->AddBezier({ { 367.00 , 250.00 }, { 333.00 , 350.00 }, { 300.00 , 300.00 } });
-
-
-    geometry_sink->EndFigure(D2D1_FIGURE_END_CLOSED);
-    if (SUCCEEDED(hr)) {
-        hr = geometry_sink->Close();
-    }
-
-    // Release the resources.
-    geometry_sink->Release();
-
-    return hr;
-}
-
-HRESULT Paint::createCurvedSegment() {
-    HRESULT hr = d2d_factory->CreatePathGeometry(&curvedSegment);
+    hr = (*geometry)->Open(&geometry_sink);
     if (FAILED(hr)) {
         return hr;
     }
 
-    // Open a sink to write to the path geometry.
-    ID2D1GeometrySink* geometry_sink = nullptr;
-    hr = curvedSegment->Open(&geometry_sink);
-    if (FAILED(hr)) {
-        return hr;
+    auto point = [](ShapePoint p, float shift) {
+        return D2D1::Point2F(p.x, p.y - shift);
+    };
+    float shift = path.start.y < SHAPE_CENTER.y ? stretch : 0.0f;
+    geometry_sink->BeginFigure(point(path.start, shift), D2D1_FIGURE_BEGIN_FILLED);
+    for (int i = 0; i < path.count; i++) {
+        const ShapeCommand& command = path.commands[i];
+        const ShapePoint* points = command.points;
+        if (command.bezier) {
+            shift = points[2].y < SHAPE_CENTER.y ? stretch : 0.0f;
+            geometry_sink->AddBezier({ point(points[0], shift), point(points[1], shift), point(points[2], shift) });
+        }
+        else {
+            shift = points[0].y < SHAPE_CENTER.y ? stretch : 0.0f;
+            geometry_sink->AddLine(point(points[0], shift));
+        }
     }
 
-    geometry_sink->BeginFigure({ 400.00f , 300.00f }, D2D1_FIGURE_BEGIN_FILLED);
-    geometry_sink->AddBezier({ { 350.00 , 333.00 }, { 450.00 , 367.00 }, { 400.00 , 400.00 } });
-    geometry_sink->AddBezier({ { 367.00 , 350.00 }, { 333.00 , 450.00 }, { 300.00 , 400.00 } });
-    geometry_sink->AddBezier({ { 300.00 , 300.00} , { 300.00 , 300.00} , { 400.00 , 300.00} });
-
-
     geometry_sink->EndFigure(D2D1_FIGURE_END_CLOSED);
-    if (SUCCEEDED(hr)) {
-        hr = geometry_sink->Close();
-    }
+    hr = geometry_sink->Close();
 
     // Release the resources.
     geometry_sink->Release();
@@ -345,222 +350,428 @@ HRESULT Paint::createCurvedSegment() {
     return hr;
 }
 
-HRESULT Paint::createHead() {
-    HRESULT hr = d2d_factory->CreatePathGeometry(&headSegment);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    // Open a sink to write to the path geometry.
-    ID2D1GeometrySink* geometry_sink = nullptr;
-    hr = headSegment->Open(&geometry_sink);
-    if (FAILED(hr)) {
-        return hr;
+HRESULT Paint::createShape(int shape) {
+    return createPath(SHAPE_PATHS[shape], 0.0f, &shape_paths[shape]);
+}
+
+// No run is longer than a side of the board, and two bends at least
+// keep runs apart
+HRESULT Paint::createRunStrips() {
+    UINT32 strip_width = std::max(board.width, board.height) + 2;
+    UINT32 strip_height = board.width * board.height / 2 + 1;
+    for (int pass = 0; pass < 2; pass++) {
+        HRESULT hr = d2d_render_target->CreateBitmap(
+            SizeU(strip_width, strip_height),
+            D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_IGNORE)),
+            &run_strips[pass]
+        );
+        if (FAILED(hr)) {
+            return hr;
+        }
+        hr = d2d_render_target->CreateBitmapBrush(
+            run_strips[pass],
+            D2D1::BitmapBrushProperties(
+                D2D1_EXTEND_MODE_CLAMP, D2D1_EXTEND_MODE_CLAMP, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR
+            ),
+            &run_brushes[pass]
+        );
+        if (FAILED(hr)) {
+            return hr;
+        }
+        // filled every frame, so it never grows afterwards
+        run_pixels[pass].reserve((size_t) strip_width * strip_height);
     }
-
-    geometry_sink->BeginFigure({ 400.00f , 300.00f }, D2D1_FIGURE_BEGIN_FILLED);
-    geometry_sink->AddBezier({ { 350.00 , 333.00 }, { 450.00 , 367.00 }, { 400.00 , 400.00 } });
-    geometry_sink->AddBezier({ { 375.00 , 388.00 }, { 375.00 , 388.00 }, { 300.00 , 375.00 } });
-    geometry_sink->AddLine({ 350.00 , 350.00 });
-    geometry_sink->AddLine({ 300.00 , 325.00 });
-    geometry_sink->AddBezier({ { 312.00 , 325.00} , { 312.00 , 325.00} , { 400.00 , 300.00} });
-
-
-    geometry_sink->EndFigure(D2D1_FIGURE_END_CLOSED);
-    if (SUCCEEDED(hr)) {
-        hr = geometry_sink->Close();
-    }
-
-    // Release the resources.
-    geometry_sink->Release();
-
-    return hr;
+    return S_OK;
 }
 
-HRESULT Paint::createTail() {
-    HRESULT hr = d2d_factory->CreatePathGeometry(&tailSegment);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    // Open a sink to write to the path geometry.
-    ID2D1GeometrySink* geometry_sink = nullptr;
-    hr = tailSegment->Open(&geometry_sink);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    geometry_sink->BeginFigure({ 400.00f , 300.00f }, D2D1_FIGURE_BEGIN_FILLED);
-    geometry_sink->AddBezier({ { 350.00 , 333.00 }, { 450.00 , 367.00 }, { 400.00 , 400.00 } });
-    geometry_sink->AddBezier({ { 325.00 , 375.00 }, { 325.00 , 375.00 }, { 300.00 , 350.00 } });
-    geometry_sink->AddBezier({ { 325.00 , 325.00} , { 325.00 , 325.00} , { 400.00 , 300.00} });
-
-
-    geometry_sink->EndFigure(D2D1_FIGURE_END_CLOSED);
-    if (SUCCEEDED(hr)) {
-        hr = geometry_sink->Close();
-    }
-
-    // Release the resources.
-    geometry_sink->Release();
-
-    return hr;
+int Paint::drawStraightSegment(int x, int y, int orientation, Color c) {
+    fillShape(SHAPE_STRAIGHT, x, y, orientation, D2D1::ColorF(c.r, c.g, c.b));
+    return 0;
 }
 
-
-HRESULT Paint::drawStraightSegment(int x, int y, int orientation, D2D1::ColorF color) {
-    ID2D1TransformedGeometry* transformed_geometry;
-
-    const D2D1_MATRIX_3X2_F transformationMatrix = getTransformation(x, y, orientation);
-    HRESULT hr;
-    hr = d2d_factory->CreateTransformedGeometry(straightSegment, &transformationMatrix, &transformed_geometry);
-    if (FAILED(hr)) {
-        return hr;
-    }
-    myBrush->SetColor(color);
-    d2d_render_target->FillGeometry(transformed_geometry, myBrush);
-    myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
-    d2d_render_target->DrawGeometry(transformed_geometry, myBrush);
-    return S_OK;
+int Paint::drawCurvedSegment(int x, int y, int orientation, Color c) {
+    fillShape(SHAPE_CURVED, x, y, orientation + 2, D2D1::ColorF(c.r, c.g, c.b));
+    return 0;
 }
 
-HRESULT Paint::drawCurvedSegment(int x, int y, int orientation, D2D1::ColorF color) {
-    ID2D1TransformedGeometry* transformed_geometry;
-
-    const D2D1_MATRIX_3X2_F transformationMatrix = getTransformation(x, y, orientation + 2);
-    HRESULT hr;
-    hr = d2d_factory->CreateTransformedGeometry(curvedSegment, &transformationMatrix, &transformed_geometry);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    myBrush->SetColor(color);
-    d2d_render_target->FillGeometry(transformed_geometry, myBrush);
-    myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
-    d2d_render_target->DrawGeometry(transformed_geometry, myBrush);
-    return S_OK;
+int Paint::drawTail(int x, int y, int orientation) {
+    fillShape(SHAPE_TAIL, x, y, orientation + 3, D2D1::ColorF(TAIL_COLOR.r, TAIL_COLOR.g, TAIL_COLOR.b));
+    return 0;
 }
 
-HRESULT Paint::drawTail(int x, int y, int orientation) {
-    ID2D1TransformedGeometry* transformed_geometry;
-
-    const D2D1_MATRIX_3X2_F transformationMatrix = getTransformation(x, y, orientation + 3);
-    HRESULT hr;
-    hr = d2d_factory->CreateTransformedGeometry(tailSegment, &transformationMatrix, &transformed_geometry);
-    if (FAILED(hr)) {
-        return hr;
-    }
-
-    D2D1::ColorF color = D2D1::ColorF(0.5, 0.25, 0.0);
-    myBrush->SetColor(color);
-    d2d_render_target->FillGeometry(transformed_geometry, myBrush);
-    myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
-    d2d_render_target->DrawGeometry(transformed_geometry, myBrush);
-    return S_OK;
+int Paint::drawHead(int x, int y, int orientation) {
+    fillShape(SHAPE_HEAD, x, y, orientation + 1, D2D1::ColorF(HEAD_COLOR.r, HEAD_COLOR.g, HEAD_COLOR.b));
+    return 0;
 }
 
-const D2D1_MATRIX_3X2_F Paint::getTransformation(int x, int y, int orientation) {   
+// Scales and rotates a shape around its center and moves it
+// to the cell at the origin of the board; only the cell offset is left
+const D2D1_MATRIX_3X2_F Paint::getCellTransformation(int orientation) {
     return D2D1::Matrix3x2F::Scale(
-            D2D1::SizeF(FIELD_HEIGHT / 100.0f, FIELD_WIDTH / 100.0f), D2D1::Point2F(350.00f, 350.00f)
+            D2D1::SizeF(field_height / SHAPE_SIZE, field_width / SHAPE_SIZE), D2D1::Point2F(SHAPE_CENTER.x, SHAPE_CENTER.y)
     ) * D2D1::Matrix3x2F::Rotation(
-            90.0f * orientation, D2D1::Point2F(350.00f, 350.00f)
+            90.0f * orientation, D2D1::Point2F(SHAPE_CENTER.x, SHAPE_CENTER.y)
     ) * D2D1::Matrix3x2F::Translation(
-        FIELD_HEIGHT * y - 350.00f + FIELD_HEIGHT / 2 + MARGIN, FIELD_WIDTH * x - 350.00f + FIELD_WIDTH / 2 + MARGIN
+        -SHAPE_CENTER.x + field_height / 2, -SHAPE_CENTER.y + field_width / 2
     );
 }
 
-HRESULT Paint::drawHead(int x, int y, int orientation) {
-    ID2D1TransformedGeometry* transformed_geometry;
-
-    const D2D1_MATRIX_3X2_F transformationMatrix = getTransformation(x, y, orientation + 1);
-    HRESULT hr;
-    hr = d2d_factory->CreateTransformedGeometry(headSegment, &transformationMatrix, &transformed_geometry);
-    if (FAILED(hr)) {
-        return hr;
+HRESULT Paint::createShapeCache() {
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        for (int orientation = 0; orientation < 4; orientation++) {
+            const D2D1_MATRIX_3X2_F transformationMatrix = getCellTransformation(orientation);
+            HRESULT hr = d2d_factory->CreateTransformedGeometry(
+                shape_paths[shape], &transformationMatrix, &shape_cache[shape][orientation]
+            );
+            if (FAILED(hr)) {
+                return hr;
+            }
+        }
     }
+    return S_OK;
+}
 
-    D2D1::ColorF color = D2D1::ColorF(0.5, 1.0, 0.5);
+void Paint::fillShape(int shape, int x, int y, int orientation, D2D1::ColorF color) {
+    ID2D1TransformedGeometry* geometry = shape_cache[shape][orientation % 4];
+    target->SetTransform(D2D1::Matrix3x2F::Translation(
+        (float) field_height * y + MARGIN, (float) field_width * x + MARGIN
+    ));
     myBrush->SetColor(color);
-    d2d_render_target->FillGeometry(transformed_geometry, myBrush);
+    target->FillGeometry(geometry, myBrush);
     myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
-    d2d_render_target->DrawGeometry(transformed_geometry, myBrush);
-    return S_OK;
+    target->DrawGeometry(geometry, myBrush);
+    target->SetTransform(D2D1::Matrix3x2F::Identity());
 }
 
 void Paint::drawBorders(float width) {
     D2D1_RECT_F rectangle = D2D1::RectF(
         (float) MARGIN - width,
         (float) MARGIN - width,
-        (float) WIN_WIDTH - MARGIN,
-        (float) WIN_HEIGHT - MARGIN);
+        (float) MARGIN + board.width * field_width,
+        (float) MARGIN + board.height * field_height);
     myBrush->SetColor(D2D1::ColorF(1, 0, 0));
-    d2d_render_target->DrawRectangle(&rectangle, myBrush, width);
+    target->DrawRectangle(&rectangle, myBrush, width);
 }
 
-void Paint::drawCandy(int x, int y, D2D1::ColorF color) {
+int Paint::drawCandy(int x, int y, Color c) {
+    D2D1::ColorF color = D2D1::ColorF(c.r, c.g, c.b);
     myBrush->SetColor(color);
     auto center = D2D1::Point2F(
-        (float) FIELD_HEIGHT * y + FIELD_HEIGHT / 2 + MARGIN,
-        (float) FIELD_WIDTH * x + FIELD_WIDTH / 2 + MARGIN
+        (float) field_height * y + field_height / 2 + MARGIN,
+        (float) field_width * x + field_width / 2 + MARGIN
     );
-    auto ellipse = D2D1::Ellipse(center, FIELD_HEIGHT / 2, FIELD_WIDTH / 2);
-    d2d_render_target->FillEllipse(ellipse, myBrush);
+    auto ellipse = D2D1::Ellipse(center, field_height / 2, field_width / 2);
+    target->FillEllipse(ellipse, myBrush);
     myBrush->SetColor(D2D1::ColorF(color.r / 2, color.b / 2, color.g / 2));
-    d2d_render_target->DrawEllipse(ellipse, myBrush, 1.0f);
+    target->DrawEllipse(ellipse, myBrush, 1.0f);
+    return 0;
 }
 
-HRESULT Paint::drawEatingParticle(int x, int y, int orientation, D2D1::ColorF color) {
-    ID2D1TransformedGeometry* transformed_geometry;
+int Paint::drawEatingAnimation(int x, int y, int orientation, Color c) {
+    D2D1::ColorF color = D2D1::ColorF(c.r, c.g, c.b);
+    fillShape(SHAPE_EATING_PARTICLE, x, y, orientation + 3, color);
+    fillShape(SHAPE_EATING_PARTICLE, x, y, orientation + 4, color);
+    return 0;
+}
 
-    const D2D1_MATRIX_3X2_F transformationMatrix = getTransformation(x, y, orientation + 1);
-    HRESULT hr;
-    hr = d2d_factory->CreateTransformedGeometry(eatingParticleSegment, &transformationMatrix, &transformed_geometry);
-    if (FAILED(hr)) {
-        return hr;
+// Shape and extra quarter turns of each command kind, as used by the
+// single-shape calls above; the eating animation also draws a second
+// particle one more turn around. Runs and the candy are drawn apart.
+static const int KIND_SHAPE[DRAW_KIND_COUNT] = {
+    SHAPE_STRAIGHT, SHAPE_CURVED, SHAPE_HEAD, SHAPE_TAIL, SHAPE_EATING_PARTICLE, 0
+};
+static const int KIND_TURN[DRAW_KIND_COUNT] = { 0, 2, 1, 3, 3, 0 };
+
+// Fills a run of commands of one kind and color with a single brush
+// color, then outlines all of them with another
+void Paint::fillBatch(const CommandBuffer& commands, int begin, int end, D2D1::ColorF color) {
+    int kind = commands.at(begin).kind;
+    int shape = KIND_SHAPE[kind];
+    int copies = kind == DRAW_EATING_ANIMATION ? 2 : 1;
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0) {
+            myBrush->SetColor(color);
+        }
+        else {
+            myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
+        }
+        for (int i = begin; i < end; i++) {
+            const RenderCommand& command = commands.at(i);
+            target->SetTransform(D2D1::Matrix3x2F::Translation(
+                (float) field_height * command.y + MARGIN, (float) field_width * command.x + MARGIN
+            ));
+            for (int copy = 0; copy < copies; copy++) {
+                ID2D1TransformedGeometry* geometry =
+                    shape_cache[shape][(command.orientation + KIND_TURN[kind] + copy) % 4];
+                if (pass == 0) {
+                    target->FillGeometry(geometry, myBrush);
+                }
+                else {
+                    target->DrawGeometry(geometry, myBrush);
+                }
+            }
+        }
+    }
+    target->SetTransform(D2D1::Matrix3x2F::Identity());
+}
+
+ID2D1TransformedGeometry* Paint::runGeometry(int orientation, int length) {
+    ID2D1TransformedGeometry*& geometry = run_cache[orientation][length];
+    if (geometry != nullptr) {
+        return geometry;
+    }
+    if (run_paths[length] == nullptr &&
+        FAILED(createPath(SHAPE_PATHS[SHAPE_STRAIGHT], (length - 1) * SHAPE_SIZE, &run_paths[length]))) {
+        return nullptr;
+    }
+    // the cell transformation turns "up" in the shape box to orientation
+    const D2D1_MATRIX_3X2_F transformationMatrix = getCellTransformation(orientation);
+    if (FAILED(d2d_factory->CreateTransformedGeometry(run_paths[length], &transformationMatrix, &geometry))) {
+        geometry = nullptr;
+    }
+    return geometry;
+}
+
+// Maps a row of the strips onto a run that starts in the cell at the
+// origin: pixel i + 1 covers its i-th cell, across the run the row is
+// stretched enough to cover the whole shape
+const D2D1_MATRIX_3X2_F Paint::getRunBrushTransformation(int orientation, int row) {
+    float along_x = (float) ORIENTATION_DY[orientation];
+    float along_y = (float) ORIENTATION_DX[orientation];
+    float cell = (float) field_width;
+    // where the run enters its first cell
+    float start_x = cell / 2 - along_x * cell / 2;
+    float start_y = cell / 2 - along_y * cell / 2;
+    float across = 4 * cell;
+    return D2D1::Matrix3x2F(
+        along_x * cell, along_y * cell,
+        -along_y * across, along_x * across,
+        start_x - along_x * cell + along_y * across * (row + 0.5f),
+        start_y - along_y * cell - along_x * across * (row + 0.5f)
+    );
+}
+
+// Writes the colors of every run of the frame to the strips, a row each
+// in the order the runs are drawn
+HRESULT Paint::updateRunStrips(const CommandBuffer& commands) {
+    UINT32 strip_width = run_strips[0]->GetPixelSize().width;
+    UINT32 rows = 0;
+    for (int i = 0; i < commands.size(); i++) {
+        const RenderCommand& command = commands.at(i);
+        if (command.kind != DRAW_STRAIGHT_RUN) {
+            continue;
+        }
+        const Color* colors = commands.runColors(command);
+        for (int pass = 0; pass < 2; pass++) {
+            // outlines are half as bright, like in fillBatch
+            float shade = pass == 0 ? 255.0f : 127.5f;
+            run_pixels[pass].resize((size_t) (rows + 1) * strip_width);
+            UINT32* pixels = run_pixels[pass].data() + (size_t) rows * strip_width;
+            for (UINT32 u = 0; u < strip_width; u++) {
+                Color color = colors[std::clamp((int) u - 1, 0, command.length - 1)];
+                pixels[u] = 0xff000000u | (UINT32) (color.r * shade) << 16 | (UINT32) (color.g * shade) << 8 |
+                    (UINT32) (color.b * shade);
+            }
+        }
+        rows++;
+    }
+    if (rows == 0) {
+        return S_OK;
+    }
+    D2D1_RECT_U rect = D2D1::RectU(0, 0, strip_width, rows);
+    for (int pass = 0; pass < 2; pass++) {
+        HRESULT hr = run_strips[pass]->CopyFromMemory(&rect, run_pixels[pass].data(), strip_width * sizeof(UINT32));
+        if (FAILED(hr)) {
+            return hr;
+        }
     }
+    return S_OK;
+}
 
-    myBrush->SetColor(color);
-    d2d_render_target->FillGeometry(transformed_geometry, myBrush);
-    myBrush->SetColor(D2D1::ColorF(color.r / 2, color.g / 2, color.b / 2));
-    d2d_render_target->DrawGeometry(transformed_geometry, myBrush);
+// A run is one geometry however long it is; the strip brushes give each
+// of its cells its own color. begin..end are all the runs of the frame.
+void Paint::fillRuns(const CommandBuffer& commands, int begin, int end) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = begin; i < end; i++) {
+            const RenderCommand& command = commands.at(i);
+            ID2D1TransformedGeometry* geometry = runGeometry(command.orientation, command.length);
+            if (geometry == nullptr) {
+                continue;
+            }
+            target->SetTransform(D2D1::Matrix3x2F::Translation(
+                (float) field_height * command.y + MARGIN, (float) field_width * command.x + MARGIN
+            ));
+            run_brushes[pass]->SetTransform(getRunBrushTransformation(command.orientation, i - begin));
+            if (pass == 0) {
+                target->FillGeometry(geometry, run_brushes[pass]);
+            }
+            else {
+                target->DrawGeometry(geometry, run_brushes[pass]);
+            }
+        }
+    }
+    target->SetTransform(D2D1::Matrix3x2F::Identity());
+}
+
+// Sorted by kind and color, the frame needs two brush changes per run of
+// equal commands instead of two per shape
+void Paint::drawBatches(const CommandBuffer& commands) {
+    int count = commands.size();
+    int end;
+    for (int begin = 0; begin < count; begin = end) {
+        const RenderCommand& first = commands.at(begin);
+        end = begin + 1;
+        while (end < count && commands.at(end).kind == first.kind && commands.at(end).color == first.color) {
+            end++;
+        }
+
+        if (first.kind == DRAW_STRAIGHT_RUN) {
+            fillRuns(commands, begin, end);
+            continue;
+        }
+        if (first.kind == DRAW_CANDY) {
+            for (int i = begin; i < end; i++) {
+                drawCandy(commands.at(i).x, commands.at(i).y, paletteColor(first.color));
+            }
+            continue;
+        }
+        Color color = paletteColor(first.color);
+        if (first.kind == DRAW_HEAD) {
+            color = HEAD_COLOR;
+        }
+        else if (first.kind == DRAW_TAIL) {
+            color = TAIL_COLOR;
+        }
+        fillBatch(commands, begin, end, D2D1::ColorF(color.r, color.g, color.b));
+    }
+}
+
+HRESULT Paint::beginLayer(ID2D1BitmapRenderTarget** layer) {
+    if (*layer == nullptr) {
+        HRESULT hr = d2d_render_target->CreateCompatibleRenderTarget(layer);
+        if (FAILED(hr)) {
+            return hr;
+        }
+    }
+    target = *layer;
+    target->BeginDraw();
     return S_OK;
 }
 
-HRESULT Paint::createEatingParticle() {
-    HRESULT hr = d2d_factory->CreatePathGeometry(&eatingParticleSegment);
+// Finishes the layer; if that fails it is dropped, to be rendered again
+HRESULT Paint::endLayer(ID2D1BitmapRenderTarget** layer) {
+    target = d2d_render_target;
+    HRESULT hr = (*layer)->EndDraw();
     if (FAILED(hr)) {
-        return hr;
+        (*layer)->Release();
+        *layer = nullptr;
     }
+    return hr;
+}
 
-    // Open a sink to write to the path geometry.
-    ID2D1GeometrySink* geometry_sink = nullptr;
-    hr = eatingParticleSegment->Open(&geometry_sink);
-    if (FAILED(hr)) {
-        return hr;
+// Copies rect of the layer to the same place on the current target
+void Paint::drawLayer(ID2D1BitmapRenderTarget* layer, D2D1_RECT_F rect) {
+    ID2D1Bitmap* bitmap = nullptr;
+    if (FAILED(layer->GetBitmap(&bitmap))) {
+        return;
     }
+    target->DrawBitmap(bitmap, rect, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, rect);
+    bitmap->Release();
+}
 
-    geometry_sink->BeginFigure({ 370.00f , 300.00f }, D2D1_FIGURE_BEGIN_FILLED);
-    geometry_sink->AddLine({ 400.0f, 330.0f });
-    geometry_sink->AddBezier({ { 400.00 , 300.00 }, { 400.00 , 300.00 }, { 390.00 , 300.00 } });
+void Paint::discardLayers() {
+    game_over_shown = false;
+    if (board_layer) board_layer->Release();
+    if (game_over_layer) game_over_layer->Release();
+    board_layer = nullptr;
+    game_over_layer = nullptr;
+    game_over_text.clear();
+}
 
+// Everything the snake is drawn over
+HRESULT Paint::renderBoardLayer() {
+    HRESULT hr = beginLayer(&board_layer);
+    if (FAILED(hr)) {
+        return hr;
+    }
+    drawBgBitmap();
+    drawBorders(BOARDER_WIDTH);
+    return endLayer(&board_layer);
+}
 
-    geometry_sink->EndFigure(D2D1_FIGURE_END_CLOSED);
-    if (SUCCEEDED(hr)) {
-        hr = geometry_sink->Close();
+// A full frame repaints everything. Otherwise each changed cell, grown by
+// half a cell to catch shapes spilling over from around it, gets the
+// background and the commands again under a clip
+int Paint::drawCommands(CommandBuffer& commands) {
+    if (board_layer == nullptr && FAILED(renderBoardLayer())) {
+        return 1;
+    }
+    game_over_shown = false;
+    commands.sortByBatch();
+    if (FAILED(updateRunStrips(commands))) {
+        return 1;
     }
+    const ChangeSet& dirty = commands.getDirty();
+    if (dirty.isAll()) {
+        drawLayer(board_layer, D2D1::RectF(0, 0, WIN_WIDTH, WIN_HEIGHT));
+        drawBatches(commands);
+        frame_kept = true;
+        return 0;
+    }
+    for (int i = 0; i < dirty.size(); i++) {
+        float left = (float) field_height * dirty.at(i).second + MARGIN - field_height / 2;
+        float top = (float) field_width * dirty.at(i).first + MARGIN - field_width / 2;
+        D2D1_RECT_F rect = D2D1::RectF(left, top, left + 2 * field_height, top + 2 * field_width);
+        target->PushAxisAlignedClip(rect, D2D1_ANTIALIAS_MODE_ALIASED);
+        drawLayer(board_layer, rect);
+        drawBatches(commands);
+        target->PopAxisAlignedClip();
+    }
+    return 0;
+}
 
-    // Release the resources.
-    geometry_sink->Release();
+bool Paint::keepsLastFrame() const {
+    return frame_kept;
+}
 
-    return hr;
+int Paint::drawGameOver(const WCHAR* text, UINT32 len) {
+    bool same_text = game_over_text.compare(0, std::wstring::npos, text, len) == 0;
+    if (game_over_shown && same_text) {
+        return 0; // the retained frame already shows it
+    }
+    if (game_over_layer == nullptr || !same_text) {
+        if (FAILED(beginLayer(&game_over_layer))) {
+            return 1;
+        }
+        setBackground(D2D1::ColorF(0.8f, 0.8f, 0.8f));
+        drawLogo();
+        writeText(text, D2D1::ColorF(0.0f, 0.0f, 0.0f), len, MARGIN, MARGIN);
+        if (FAILED(endLayer(&game_over_layer))) {
+            return 1;
+        }
+        game_over_text.assign(text, len);
+    }
+    drawLayer(game_over_layer, D2D1::RectF(0, 0, WIN_WIDTH, WIN_HEIGHT));
+    game_over_shown = true;
+    frame_kept = false; // the board is gone from the screen
+    return 0;
 }
 
-HRESULT Paint::drawEatingAnimation(int x, int y, int orientation, D2D1::ColorF color) {
-    HRESULT hr = drawEatingParticle(x, y, orientation + 2, color);
-    if (FAILED(hr)) {
-        return hr;
+// The layers are as big as the target, so they are made again
+int Paint::resize(HWND& hwnd) {
+    if (d2d_render_target == nullptr) {
+        return 0;
     }
-    return drawEatingParticle(x, y, orientation + 3, color);
+    frame_kept = false;
+    discardLayers();
+    if (FAILED(createRectangleFromWindow(hwnd))) {
+        return 1;
+    }
+    HRESULT hr = d2d_render_target->Resize(SizeU(
+        static_cast<UINT32>(rc.right - rc.left),
+        static_cast<UINT32>(rc.bottom - rc.top)
+    ));
+    return FAILED(hr) ? 1 : 0;
 }
 
 int Paint::createResources(HWND& hwnd) {
@@ -587,23 +798,13 @@ int Paint::createResources(HWND& hwnd) {
         return 1;
     }
 
-    if (FAILED(createStraightSegment())) {
-        return 1;
-    }
-
-    if (FAILED(createCurvedSegment())) {
-        return 1;
-    }
-
-    if (FAILED(createHead())) {
-        return 1;
-    }
-
-    if (FAILED(createTail())) {
-        return 1;
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        if (FAILED(createShape(shape))) {
+            return 1;
+        }
     }
 
-    if (FAILED(createEatingParticle())) {
+    if (FAILED(createShapeCache())) {
         return 1;
     }
 
@@ -614,6 +815,18 @@ int Paint::createResources(HWND& hwnd) {
     return 0;
 }
 
+Paint::Paint(BoardSize size) {
+    board = size;
+    field_width = cellSize(size);
+    field_height = field_width;
+    // runs are at most as long as a side of the board
+    int longest = std::max(size.width, size.height);
+    run_paths.resize(longest + 1, nullptr);
+    for (int orientation = 0; orientation < 4; orientation++) {
+        run_cache[orientation].resize(longest + 1, nullptr);
+    }
+}
+
 Paint::~Paint() {
     freeResources(); //TODO add new resources' freeing
 }
\ No newline at end of file
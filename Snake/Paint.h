@@ -14,24 +14,22 @@
 #include <d2d1helper.h>
 #include <dwrite_3.h>
 #include <wincodec.h>
-#include <math.h>
-
-
-const int WIN_WIDTH = 1200;
-const int WIN_HEIGHT = 620;
-const int GRID_WIDTH = 40;
-const int GRID_HEIGHT = 20;
-const int MARGIN = 20;
-
-const int FIELD_WIDTH = (WIN_WIDTH - 2 * MARGIN) / GRID_WIDTH;
-const int FIELD_HEIGHT = (WIN_HEIGHT - 2 * MARGIN) / GRID_HEIGHT;
+#include <string>
+#include <vector>
 
-const float SPEED = (float) 0.4;
-const float FONT_SIZE = 50.0f;
-const float BOARDER_WIDTH = 5.0f;
+#include "Config.h"
+#include "RenderSink.h"
+#include "Layout.h"
+#include "Shapes.h"
+#include "CommandBuffer.h"
 
-class Paint {
+class Paint : public RenderSink {
 private:
+	BoardSize board;
+	// size of one cell in pixels, cells are kept square
+	int field_width;
+	int field_height;
+
 	ID2D1Factory7* d2d_factory = nullptr;
 	ID2D1HwndRenderTarget* d2d_render_target = nullptr;
 	RECT rc;
@@ -42,11 +40,36 @@ private:
 	IWICImagingFactory* pIWICFactory = nullptr;
 	ID2D1Bitmap* pBgBitmap = nullptr;
 	ID2D1Bitmap* pLogoBitmap = nullptr;
-	ID2D1PathGeometry* straightSegment = nullptr;
-	ID2D1PathGeometry* curvedSegment = nullptr;
-	ID2D1PathGeometry* headSegment = nullptr;
-	ID2D1PathGeometry* tailSegment = nullptr;
-	ID2D1PathGeometry* eatingParticleSegment = nullptr;
+	ID2D1PathGeometry* shape_paths[SHAPE_COUNT] = {};
+
+	// Every shape in all four rotations, already scaled to a cell at the
+	// origin of the board; drawing only has to move it to its cell
+	ID2D1TransformedGeometry* shape_cache[SHAPE_COUNT][4] = {};
+
+	// Straight runs by length: the straight shape with its far end moved
+	// length - 1 cells on, made the first time a run that long is drawn
+	std::vector<ID2D1PathGeometry*> run_paths;
+	std::vector<ID2D1TransformedGeometry*> run_cache[4];
+
+	// Fill and outline colors of the runs of a frame, a row per run and a
+	// pixel per cell, with one more at both ends for the rounded caps
+	ID2D1Bitmap* run_strips[2] = {};
+	ID2D1BitmapBrush* run_brushes[2] = {};
+	std::vector<UINT32> run_pixels[2];
+
+	// the render target still holds the last full frame
+	bool frame_kept = false;
+
+	// Where drawing goes: the window, or a layer while one is rendered
+	ID2D1RenderTarget* target = nullptr;
+
+	// Parts of the screen that rarely change, rendered once offscreen and
+	// only copied afterwards. They go with the render target on resize
+	// and device loss; the game-over one also when its text changes.
+	ID2D1BitmapRenderTarget* board_layer = nullptr;
+	ID2D1BitmapRenderTarget* game_over_layer = nullptr;
+	std::wstring game_over_text;
+	bool game_over_shown = false; // and still on the render target
 
 	HRESULT createIWICFactory();
 
@@ -68,13 +91,11 @@ private:
 
 	HRESULT createBitmap(LPCWSTR file_name, ID2D1Bitmap** ptr);
 
-	HRESULT createStraightSegment();
+	HRESULT createPath(const ShapePath& path, float stretch, ID2D1PathGeometry** geometry);
 
-	HRESULT createCurvedSegment();
+	HRESULT createShape(int shape);
 
-	HRESULT createHead();
-
-	HRESULT createTail();
+	HRESULT createRunStrips();
 
 	void DiscardRenderDeviceResources();
 
@@ -82,14 +103,38 @@ private:
 
 	void freeResources();
 
-	const D2D1_MATRIX_3X2_F getTransformation(int x, int y, int orientation);
+	const D2D1_MATRIX_3X2_F getCellTransformation(int orientation);
+
+	HRESULT createShapeCache();
+
+	void fillShape(int shape, int x, int y, int orientation, D2D1::ColorF color);
 
-	HRESULT drawEatingParticle(int x, int y, int orientation, D2D1::ColorF color);
+	void fillBatch(const CommandBuffer& commands, int begin, int end, D2D1::ColorF color);
 
-	HRESULT createEatingParticle();
+	ID2D1TransformedGeometry* runGeometry(int orientation, int length);
+
+	const D2D1_MATRIX_3X2_F getRunBrushTransformation(int orientation, int row);
+
+	HRESULT updateRunStrips(const CommandBuffer& commands);
+
+	void fillRuns(const CommandBuffer& commands, int begin, int end);
+
+	void drawBatches(const CommandBuffer& commands);
+
+	HRESULT beginLayer(ID2D1BitmapRenderTarget** layer);
+
+	HRESULT endLayer(ID2D1BitmapRenderTarget** layer);
+
+	void drawLayer(ID2D1BitmapRenderTarget* layer, D2D1_RECT_F rect);
+
+	void discardLayers();
+
+	HRESULT renderBoardLayer();
 
 public:
 
+	Paint(BoardSize size);
+
 	~Paint();
 
 	void setBackground(D2D1::ColorF color);
@@ -102,23 +147,32 @@ public:
 
 	void drawBgBitmap();
 
-	HRESULT drawStraightSegment(int x, int y, int orientation, D2D1::ColorF color);
+	int drawStraightSegment(int x, int y, int orientation, Color color) override;
 
-	HRESULT drawCurvedSegment(int x, int y, int orientation, D2D1::ColorF color);
+	int drawCurvedSegment(int x, int y, int orientation, Color color) override;
 
-	HRESULT drawHead(int x, int y, int orientation);
+	int drawHead(int x, int y, int orientation) override;
 
-	HRESULT drawTail(int x, int y, int orientation);
+	int drawTail(int x, int y, int orientation) override;
 
 	int createResources(HWND& hwnd);
 
 	void drawBorders(float width);
 
-	void drawCandy(int x, int y, D2D1::ColorF color);
+	int drawCandy(int x, int y, Color color) override;
+
+	int drawEatingAnimation(int x, int y, int orientation, Color color) override;
 
-	HRESULT drawEatingAnimation(int x, int y, int orientation, D2D1::ColorF color);
+	int drawCommands(CommandBuffer& commands) override;
+
+	bool keepsLastFrame() const override;
 
 	void drawLogo();
+
+	// The whole game-over screen: logo and text over a plain background
+	int drawGameOver(const WCHAR* text, UINT32 len);
+
+	int resize(HWND& hwnd);
 };
 
 #endif 
\ No newline at end of file
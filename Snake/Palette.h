@@ -0,0 +1,34 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstdint>
+
+#include "RenderSink.h"
+
+// Snake and candy colors are snapped to PALETTE_LEVELS shades per channel,
+// so even a long snake uses only a few distinct colors and a renderer can
+// draw everything of one color together
+const int PALETTE_LEVELS = 4;
+const int PALETTE_SIZE = PALETTE_LEVELS * PALETTE_LEVELS * PALETTE_LEVELS;
+
+// Index of the palette color nearest to color (channels in 0..1)
+inline uint8_t paletteIndex(Color color) {
+	auto level = [](float value) {
+		int l = (int) (value * PALETTE_LEVELS);
+		return l < 0 ? 0 : (l >= PALETTE_LEVELS ? PALETTE_LEVELS - 1 : l);
+	};
+	return (uint8_t) ((level(color.r) * PALETTE_LEVELS + level(color.g)) * PALETTE_LEVELS + level(color.b));
+}
+
+inline Color paletteColor(int index) {
+	auto shade = [](int level) {
+		return (level + 0.5f) / PALETTE_LEVELS;
+	};
+	return Color{
+		shade(index / (PALETTE_LEVELS * PALETTE_LEVELS)),
+		shade(index / PALETTE_LEVELS % PALETTE_LEVELS),
+		shade(index % PALETTE_LEVELS)
+	};
+}
+
+#endif
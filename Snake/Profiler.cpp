@@ -0,0 +1,141 @@
+#include "Profiler.h"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+
+const char* const PHASE_NAMES[PHASE_COUNT] = { "input", "tick", "candy", "draw", "submit", "present" };
+
+Profiler profiler;
+
+Histogram::Histogram() {
+	clear();
+}
+
+// The first eight buckets hold 0..7 ns exactly; after that every power
+// of two is split into eight by the three bits below its highest one
+int Histogram::bucketOf(uint64_t ns) {
+	if (ns < SUB_BUCKETS) {
+		return (int) ns;
+	}
+	int exponent = std::bit_width(ns) - 1;
+	int mantissa = (int) (ns >> (exponent - 3)) & (SUB_BUCKETS - 1);
+	return (exponent - 2) * SUB_BUCKETS + mantissa;
+}
+
+uint64_t Histogram::bucketLimit(int bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return (uint64_t) bucket;
+	}
+	int exponent = bucket / SUB_BUCKETS + 2;
+	uint64_t mantissa = (uint64_t) (bucket % SUB_BUCKETS) + SUB_BUCKETS;
+	// the next bucket starts one step further
+	return ((mantissa + 1) << (exponent - 3)) - 1;
+}
+
+void Histogram::record(uint64_t ns) {
+	buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+	total_count.fetch_add(1, std::memory_order_relaxed);
+	total_ns.fetch_add(ns, std::memory_order_relaxed);
+	uint64_t longest = max_ns.load(std::memory_order_relaxed);
+	while (ns > longest && !max_ns.compare_exchange_weak(longest, ns, std::memory_order_relaxed)) {
+	}
+}
+
+void Histogram::clear() {
+	for (std::atomic<uint64_t>& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	total_count.store(0, std::memory_order_relaxed);
+	total_ns.store(0, std::memory_order_relaxed);
+	max_ns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::percentile(double p) const {
+	uint64_t records = count();
+	if (records == 0) {
+		return 0;
+	}
+	// the rank-th shortest record, counting from 1
+	uint64_t rank = (uint64_t) (p * records);
+	if (rank < 1) {
+		rank = 1;
+	}
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < BUCKETS; bucket++) {
+		seen += bucketCount(bucket);
+		if (seen >= rank) {
+			// never more than what was actually seen
+			uint64_t limit = bucketLimit(bucket);
+			return limit < max() ? limit : max();
+		}
+	}
+	return max();
+}
+
+void Profiler::clear() {
+	for (Histogram& phase : phases) {
+		phase.clear();
+	}
+}
+
+static double microseconds(uint64_t ns) {
+	return ns / 1000.0;
+}
+
+int Profiler::writeCSV(const char* file_name) const {
+	FILE* file = fopen(file_name, "w");
+	if (!file) {
+		return 1;
+	}
+	fprintf(file, "phase,count,mean_us,p50_us,p99_us,max_us\n");
+	for (int phase = 0; phase < PHASE_COUNT; phase++) {
+		const Histogram& histogram = phases[phase];
+		uint64_t records = histogram.count();
+		fprintf(file, "%s,%llu,%.3f,%.3f,%.3f,%.3f\n", PHASE_NAMES[phase], (unsigned long long) records,
+			records ? microseconds(histogram.sum()) / records : 0.0,
+			microseconds(histogram.percentile(0.5)), microseconds(histogram.percentile(0.99)),
+			microseconds(histogram.max()));
+	}
+	return fclose(file) != 0;
+}
+
+int Profiler::writeJSON(const char* file_name) const {
+	FILE* file = fopen(file_name, "w");
+	if (!file) {
+		return 1;
+	}
+	fprintf(file, "{\n");
+	for (int phase = 0; phase < PHASE_COUNT; phase++) {
+		const Histogram& histogram = phases[phase];
+		uint64_t records = histogram.count();
+		fprintf(file, "  \"%s\": {\"count\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f,\n",
+			PHASE_NAMES[phase], (unsigned long long) records,
+			records ? microseconds(histogram.sum()) / records : 0.0,
+			microseconds(histogram.percentile(0.5)), microseconds(histogram.percentile(0.99)),
+			microseconds(histogram.max()));
+		// only the buckets that were hit, as [longest ns, records]
+		fprintf(file, "    \"buckets\": [");
+		bool first = true;
+		for (int bucket = 0; bucket < Histogram::BUCKETS; bucket++) {
+			uint64_t hits = histogram.bucketCount(bucket);
+			if (hits == 0) {
+				continue;
+			}
+			fprintf(file, "%s[%llu, %llu]", first ? "" : ", ",
+				(unsigned long long) Histogram::bucketLimit(bucket), (unsigned long long) hits);
+			first = false;
+		}
+		fprintf(file, "]}%s\n", phase + 1 < PHASE_COUNT ? "," : "");
+	}
+	fprintf(file, "}\n");
+	return fclose(file) != 0;
+}
+
+int Profiler::write(const char* file_name) const {
+	size_t length = strlen(file_name);
+	if (length >= 5 && strcmp(file_name + length - 5, ".json") == 0) {
+		return writeJSON(file_name);
+	}
+	return writeCSV(file_name);
+}
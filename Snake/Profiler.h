@@ -0,0 +1,126 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Parts of a tick and of a frame that are timed separately
+enum ProfilePhase {
+	PHASE_INPUT,	// handling a key
+	PHASE_TICK,		// Snake::moveOneStep, candy placement included
+	PHASE_CANDY,	// placing a new candy
+	PHASE_DRAW,		// Snake::draw recording the frame
+	PHASE_SUBMIT,	// the backend drawing the recorded frame
+	PHASE_PRESENT,	// ending the frame, Paint::endDraw
+	PHASE_COUNT
+};
+
+extern const char* const PHASE_NAMES[PHASE_COUNT];
+
+/************************************************************************
+*	Durations in nanoseconds, counted in buckets eight to a power of	*
+*	two, so a percentile is off by at most an eighth of its value.		*
+*	Every update is a relaxed atomic add: any number of threads may		*
+*	record while another one reads, without a lock.						*
+************************************************************************/
+class Histogram {
+public:
+	static const int SUB_BUCKETS = 8;
+	static const int BUCKETS = (64 - 2) * SUB_BUCKETS;
+
+private:
+	std::atomic<uint64_t> buckets[BUCKETS];
+	std::atomic<uint64_t> total_count;
+	std::atomic<uint64_t> total_ns;
+	std::atomic<uint64_t> max_ns;
+
+	static int bucketOf(uint64_t ns);
+
+public:
+	Histogram();
+
+	void record(uint64_t ns);
+
+	void clear();
+
+	inline uint64_t count() const {
+		return total_count.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t sum() const {
+		return total_ns.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t max() const {
+		return max_ns.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t bucketCount(int bucket) const {
+		return buckets[bucket].load(std::memory_order_relaxed);
+	}
+
+	// Longest duration that falls into the bucket
+	static uint64_t bucketLimit(int bucket);
+
+	// Duration that p (0..1) of the records don't exceed, rounded up to
+	// its bucket; 0 if nothing was recorded
+	uint64_t percentile(double p) const;
+};
+
+/************************************************************************
+*	One histogram per phase, shared by the whole program. Reports go	*
+*	to CSV (a line per phase) or JSON (with the buckets as well).		*
+************************************************************************/
+class Profiler {
+private:
+	Histogram phases[PHASE_COUNT];
+
+public:
+	inline void record(ProfilePhase phase, std::chrono::steady_clock::duration duration) {
+		phases[phase].record((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+
+	inline const Histogram& get(ProfilePhase phase) const {
+		return phases[phase];
+	}
+
+	void clear();
+
+	int writeCSV(const char* file_name) const;
+
+	int writeJSON(const char* file_name) const;
+
+	// JSON if the name ends with ".json", CSV otherwise
+	int write(const char* file_name) const;
+};
+
+extern Profiler profiler;
+
+// Times the rest of the enclosing block
+class ProfileScope {
+private:
+	ProfilePhase phase;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	explicit ProfileScope(ProfilePhase p) : phase(p), start(std::chrono::steady_clock::now()) {
+	}
+
+	~ProfileScope() {
+		profiler.record(phase, std::chrono::steady_clock::now() - start);
+	}
+};
+
+// Without SNAKE_PROFILE the timing points compile to nothing
+#ifdef SNAKE_PROFILE
+const bool PROFILING = true;
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#else
+const bool PROFILING = false;
+#define PROFILE_SCOPE(phase) ((void) 0)
+#endif
+
+#endif
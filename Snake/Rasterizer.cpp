@@ -0,0 +1,289 @@
+#include "Rasterizer.h"
+
+#include <cmath>
+#include <algorithm>
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTERIZER_SSE2
+#endif
+
+Rasterizer::Rasterizer() {
+	min_x = min_y = INFINITY;
+	max_x = max_y = -INFINITY;
+	resetClip();
+}
+
+void Rasterizer::reserve(int width, int height, int edge_count) {
+	// the widest box blendBands() makes, see there
+	size_t stride = (size_t) (width + 1 + 2 + 3) & ~(size_t) 3;
+	edges.reserve(edge_count);
+	area.reserve(stride * height);
+	alpha.reserve(stride);
+	source.reserve(stride);
+}
+
+void Rasterizer::setClip(int x0, int y0, int x1, int y1) {
+	clip_x0 = x0;
+	clip_y0 = y0;
+	clip_x1 = x1;
+	clip_y1 = y1;
+}
+
+void Rasterizer::resetClip() {
+	setClip(INT_MIN, INT_MIN, INT_MAX, INT_MAX);
+}
+
+// Heights are put on the grid of COVERAGE_ONE, see accumulate()
+static inline float snapY(float y) {
+	return std::nearbyint(y * COVERAGE_ONE) / COVERAGE_ONE;
+}
+
+void Rasterizer::addLine(RasterPoint from, RasterPoint to) {
+	from.y = snapY(from.y);
+	to.y = snapY(to.y);
+	edges.push_back({ from, to });
+	min_x = std::min({ min_x, from.x, to.x });
+	min_y = std::min({ min_y, from.y, to.y });
+	max_x = std::max({ max_x, from.x, to.x });
+	max_y = std::max({ max_y, from.y, to.y });
+}
+
+void Rasterizer::addPolygon(const RasterPoint* points, int count) {
+	for (int i = 0; i < count; i++) {
+		addLine(points[i], points[(i + 1) % count]);
+	}
+}
+
+void Rasterizer::addStroke(const RasterPoint* points, int count, float width) {
+	// every side becomes a thin quad; they all wind the same way as
+	// the normal always points to the same side of the direction
+	for (int i = 0; i < count; i++) {
+		RasterPoint from = points[i];
+		RasterPoint to = points[(i + 1) % count];
+		float dx = to.x - from.x;
+		float dy = to.y - from.y;
+		float length = std::sqrt(dx * dx + dy * dy);
+		if (length == 0.0f) {
+			continue;
+		}
+		float nx = -dy / length * width / 2;
+		float ny = dx / length * width / 2;
+		RasterPoint quad[4] = {
+			{ from.x + nx, from.y + ny },
+			{ to.x + nx, to.y + ny },
+			{ to.x - nx, to.y - ny },
+			{ from.x - nx, from.y - ny }
+		};
+		addPolygon(quad, 4);
+	}
+}
+
+static inline int32_t roundToInt(float value) {
+	return (int32_t) (value + (value < 0 ? -0.5f : 0.5f));
+}
+
+// Adds the area between the edge and the right side of the box, pixel by
+// pixel, to the rows it crosses. A pixel only gets the difference to its
+// left neighbour, the running sum along the row restores the coverage.
+// Everything is worked out on the screen, not in the box, and the parts
+// of a row add up to exactly the height of the edge in it: a pixel then
+// gets the same coverage whatever else is in the box, so figures sharing
+// some pixels with an earlier frame paint them the same way again.
+void Rasterizer::accumulate(const Edge& edge, int left, int top, int stride, int rows) {
+	RasterPoint p0 = edge.from;
+	RasterPoint p1 = edge.to;
+	if (p0.y == p1.y) {
+		return;
+	}
+	int32_t direction = 1;
+	if (p0.y > p1.y) {
+		std::swap(p0, p1);
+		direction = -1;
+	}
+
+	if (std::min(p0.x, p1.x) >= left + stride - 1) {
+		return; // right of the box
+	}
+
+	float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+	int first_row = std::max(top, (int) std::floor(p0.y));
+	int last_row = std::min(top + rows, (int) std::ceil(p1.y));
+	for (int y = first_row; y < last_row; y++) {
+		// the box starts at (left, top)
+		int32_t* row = area.data() + (size_t) (y - top) * stride;
+		float y0 = std::max((float) y, p0.y);
+		float y1 = std::min((float) (y + 1), p1.y);
+		float x = p0.x + dxdy * (y0 - p0.y);
+		float x_next = p0.x + dxdy * (y1 - p0.y);
+		// exact, y is on the grid of COVERAGE_ONE
+		int32_t d = direction * roundToInt((y1 - y0) * COVERAGE_ONE);
+		float x0 = std::min(x, x_next);
+		float x1 = std::max(x, x_next);
+		float x0_floor = std::floor(x0);
+		int x0i = (int) x0_floor - left;
+		float x1_ceil = std::ceil(x1);
+		int x1i = (int) x1_ceil - left;
+
+		// what lands right of the box is all added to its last column
+		int end = stride - 1;
+		if (x1i <= x0i + 1) {
+			// the edge stays inside one pixel of this row
+			float xmf = 0.5f * (x + x_next) - x0_floor;
+			int32_t right = roundToInt(d * xmf);
+			row[std::min(x0i, end)] += d - right;
+			row[std::min(x0i + 1, end)] += right;
+		}
+		else {
+			float s = 1.0f / (x1 - x0);
+			float x0f = x0 - x0_floor;
+			float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+			float x1f = x1 - x1_ceil + 1.0f;
+			float am = 0.5f * s * x1f * x1f;
+			int32_t first = roundToInt(d * a0);
+			int32_t last = roundToInt(d * am);
+			// what is left of d goes to the pixel before the last one
+			int32_t rest = d - first - last;
+			row[std::min(x0i, end)] += first;
+			if (x1i > x0i + 2) {
+				float a1 = s * (1.5f - x0f);
+				int32_t second = roundToInt(d * (a1 - a0));
+				int32_t middle = roundToInt(d * s);
+				row[std::min(x0i + 1, end)] += second;
+				rest -= second + middle * (x1i - x0i - 3);
+				int xi = x0i + 2;
+				for (; xi < std::min(x1i - 1, end); xi++) {
+					row[xi] += middle;
+				}
+				row[end] += middle * std::max(x1i - 1 - xi, 0);
+			}
+			row[std::min(x1i - 1, end)] += rest;
+			row[std::min(x1i, end)] += last;
+		}
+	}
+}
+
+// Running sum of one row, folded to coverage in 0..128
+void Rasterizer::coverRow(const int32_t* row, int stride, float opacity) {
+	int32_t* out = alpha.data();
+	float scale = 128.0f * opacity / COVERAGE_ONE;
+#ifdef RASTERIZER_SSE2
+	const __m128i one = _mm_set1_epi32(COVERAGE_ONE);
+	const __m128 scale4 = _mm_set1_ps(scale);
+	__m128i offset = _mm_setzero_si128();
+	for (int i = 0; i < stride; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (row + i));
+		// prefix sum of the four lanes
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi32(x, offset);
+		offset = _mm_shuffle_epi32(x, 0xff);
+		// min(|x|, one) without SSE4
+		__m128i sign = _mm_srai_epi32(x, 31);
+		__m128i coverage = _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+		__m128i over = _mm_cmpgt_epi32(coverage, one);
+		coverage = _mm_or_si128(_mm_andnot_si128(over, coverage), _mm_and_si128(over, one));
+		_mm_storeu_si128((__m128i*) (out + i), _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(coverage), scale4)));
+	}
+#else
+	int32_t sum = 0;
+	for (int i = 0; i < stride; i++) {
+		sum += row[i];
+		int32_t coverage = std::min(std::abs(sum), COVERAGE_ONE);
+		out[i] = (int32_t) std::lrint((float) coverage * scale);
+	}
+#endif
+}
+
+static inline uint32_t blendPixel(uint32_t dst, uint32_t src, int32_t a) {
+	uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		int32_t d = (dst >> shift) & 0xff;
+		int32_t s = (src >> shift) & 0xff;
+		result |= (uint32_t) (d + (((s - d) * a) >> 7)) << shift;
+	}
+	return result;
+}
+
+void Rasterizer::blend(uint32_t* pixels, int width, int height, uint32_t color, float opacity) {
+	blendBands(pixels, width, height, &color, 1, 0.0f, 1.0f, false, opacity);
+}
+
+// Color of the band under the pixel center at coordinate c
+static inline uint32_t bandColor(const uint32_t* colors, int count, float start, float band, int c) {
+	int i = (int) std::floor((c + 0.5f - start) / band);
+	return colors[std::clamp(i, 0, count - 1)];
+}
+
+void Rasterizer::blendBands(uint32_t* pixels, int width, int height, const uint32_t* colors, int count,
+	float start, float band, bool vertical, float opacity) {
+	if (edges.empty()) {
+		return;
+	}
+
+	// one spare column on the left and two on the right keep every
+	// write of accumulate() inside the row. Rows don't depend on each
+	// other and a pixel only on those left of it, so the box stops at
+	// the clip but for the columns on its left.
+	int left = (int) std::floor(min_x) - 1;
+	int top = std::max({ (int) std::floor(min_y), clip_y0, 0 });
+	int right = std::min({ (int) std::ceil(max_x), clip_x1, width });
+	int stride = (std::max(right - left, 0) + 2 + 3) & ~3;
+	int rows = std::max(0, std::min({ (int) std::ceil(max_y), clip_y1, height }) - top);
+	area.assign((size_t) stride * rows, 0);
+	alpha.resize(stride);
+	source.resize(stride);
+
+	for (const Edge& edge : edges) {
+		accumulate(edge, left, top, stride, rows);
+	}
+	edges.clear();
+	min_x = min_y = INFINITY;
+	max_x = max_y = -INFINITY;
+
+	int first = std::max(0, std::max(0, clip_x0) - left);
+	int last = std::min(stride, std::min(width, clip_x1) - left);
+	// one band is a plain color, whichever way it goes
+	vertical = vertical && count > 1;
+	for (int x = first; x < last; x++) {
+		source[x] = vertical || count == 1 ? colors[0] : bandColor(colors, count, start, band, left + x);
+	}
+#ifdef RASTERIZER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+#endif
+	for (int y = 0; y < rows; y++) {
+		if (vertical) {
+			std::fill(source.begin() + first, source.begin() + last, bandColor(colors, count, start, band, top + y));
+		}
+		coverRow(area.data() + (size_t) y * stride, stride, opacity);
+		uint32_t* target = pixels + (size_t) (top + y) * width;
+		int x = first;
+#ifdef RASTERIZER_SSE2
+		// four pixels at a time, 16 bits per channel
+		for (; x + 4 <= last; x += 4) {
+			__m128i a = _mm_loadu_si128((const __m128i*) (alpha.data() + x));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xffff) {
+				continue;
+			}
+			__m128i a16 = _mm_packs_epi32(a, a);
+			a16 = _mm_unpacklo_epi16(a16, a16);
+			__m128i a01 = _mm_unpacklo_epi32(a16, a16);
+			__m128i a23 = _mm_unpackhi_epi32(a16, a16);
+
+			__m128i src = _mm_loadu_si128((const __m128i*) (source.data() + x));
+			__m128i dst = _mm_loadu_si128((const __m128i*) (target + left + x));
+			__m128i lo = _mm_unpacklo_epi8(dst, zero);
+			__m128i hi = _mm_unpackhi_epi8(dst, zero);
+			lo = _mm_add_epi16(lo, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(src, zero), lo), a01), 7));
+			hi = _mm_add_epi16(hi, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(src, zero), hi), a23), 7));
+			_mm_storeu_si128((__m128i*) (target + left + x), _mm_packus_epi16(lo, hi));
+		}
+#endif
+		for (; x < last; x++) {
+			if (alpha[x]) {
+				target[left + x] = blendPixel(target[left + x], source[x], alpha[x]);
+			}
+		}
+	}
+}
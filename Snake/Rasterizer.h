@@ -0,0 +1,83 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+
+// A fully covered pixel; coverage is added up in whole parts of it
+const int32_t COVERAGE_ONE = 1 << 12;
+
+struct RasterPoint {
+	float x;
+	float y;
+};
+
+/************************************************************************
+*	Anti-aliased polygon filler for a 32-bit 0xAARRGGBB framebuffer.	*
+*	Edges are collected first; blend() then accumulates the signed		*
+*	area every edge covers in each pixel of their bounding box, turns	*
+*	the running sum of every row into coverage and mixes the colour		*
+*	into the pixels by that coverage. Overlapping figures add up, so	*
+*	all polygons of one call should wind the same way.					*
+************************************************************************/
+class Rasterizer {
+private:
+	struct Edge {
+		RasterPoint from;
+		RasterPoint to;
+	};
+
+	std::vector<Edge> edges;
+	float min_x;
+	float min_y;
+	float max_x;
+	float max_y;
+
+	// pixels outside [clip_x0, clip_x1) x [clip_y0, clip_y1) are left alone
+	int clip_x0;
+	int clip_y0;
+	int clip_x1;
+	int clip_y1;
+
+	// signed area per pixel of the bounding box in COVERAGE_ONE units,
+	// rows padded to 4 pixels
+	std::vector<int32_t> area;
+	// coverage of one row scaled to 0..128
+	std::vector<int32_t> alpha;
+	// color under each pixel of one row
+	std::vector<uint32_t> source;
+
+	void accumulate(const Edge& edge, int left, int top, int stride, int rows);
+
+	void coverRow(const int32_t* row, int stride, float opacity);
+
+public:
+	Rasterizer();
+
+	void addLine(RasterPoint from, RasterPoint to);
+
+	// closed polygon
+	void addPolygon(const RasterPoint* points, int count);
+
+	// outline of a closed polygon, width pixels wide
+	void addStroke(const RasterPoint* points, int count, float width);
+
+	// Makes room for figures of up to edge_count edges on a framebuffer
+	// of width x height pixels, so drawing them doesn't allocate
+	void reserve(int width, int height, int edge_count);
+
+	void setClip(int x0, int y0, int x1, int y1);
+
+	void resetClip();
+
+	// Paints everything added so far and starts over
+	void blend(uint32_t* pixels, int width, int height, uint32_t color, float opacity);
+
+	// Same, but colors[i] is used from start + i * band on, up to the
+	// next one; the bands go across x, or across y if vertical. Pixels
+	// before the first band or after the last take its color.
+	void blendBands(uint32_t* pixels, int width, int height, const uint32_t* colors, int count,
+		float start, float band, bool vertical, float opacity);
+};
+
+#endif
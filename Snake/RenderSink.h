@@ -0,0 +1,49 @@
+#ifndef RENDER_SINK_H
+#define RENDER_SINK_H
+
+class CommandBuffer;
+
+struct Color {
+	float r;
+	float g;
+	float b;
+};
+
+/************************************************************************
+*	Everything the engine needs from a renderer. Coordinates are grid	*
+*	cells (x is the row, y is the column) and orientations use the		*
+*	same 0..3 convention as Snake. Every call returns 0 on success.		*
+************************************************************************/
+class RenderSink {
+public:
+	virtual ~RenderSink() = default;
+
+	virtual int drawStraightSegment(int x, int y, int orientation, Color color) = 0;
+
+	virtual int drawCurvedSegment(int x, int y, int orientation, Color color) = 0;
+
+	virtual int drawHead(int x, int y, int orientation) = 0;
+
+	virtual int drawTail(int x, int y, int orientation) = 0;
+
+	virtual int drawCandy(int x, int y, Color color) = 0;
+
+	virtual int drawEatingAnimation(int x, int y, int orientation, Color color) = 0;
+
+	// length straight segments in a row, from (x, y) on in the given
+	// orientation; colors holds one color per cell. By default they are
+	// drawn one by one.
+	virtual int drawStraightRun(int x, int y, int orientation, int length, const Color* colors);
+
+	// A whole frame at once; the commands may be reordered. By default
+	// they are passed one by one to the calls above.
+	virtual int drawCommands(CommandBuffer& commands);
+
+	// Whether the last frame is still on screen, so the next one may
+	// only repaint what changed
+	virtual bool keepsLastFrame() const {
+		return false;
+	}
+};
+
+#endif
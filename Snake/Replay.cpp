@@ -0,0 +1,279 @@
+#include "Replay.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Varint.h"
+
+// The code after the three Actions: an escaped varint follows
+static const uint32_t ESCAPE = 3;
+
+// Turn the next tick makes, as set by Snake::turn
+static Action pendingAction(const Snake& snake) {
+	if (!snake.orientation_changed) {
+		return Action::STRAIGHT;
+	}
+	return snake.new_orientation == (snake.orientation + 1) % 4 ? Action::RIGHT : Action::LEFT;
+}
+
+ReplayWriter::ReplayWriter() {
+	pending = 0;
+	pending_bits = 0;
+	idle = 0;
+	ticks = 0;
+	bytes.reserve(4096); // a long game, so most never grow it
+}
+
+// A tick never takes more than its two bits; the header, the end code
+// and the result take less than 64 bytes more
+void ReplayWriter::reserve(uint64_t ticks) {
+	ticks = std::min(ticks, REPLAY_RESERVE_TICKS);
+	bytes.reserve((std::size_t) (ticks / 4) + 64);
+}
+
+void ReplayWriter::putBits(uint32_t value, int count) {
+	pending |= value << pending_bits;
+	pending_bits += count;
+	while (pending_bits >= 8) {
+		bytes.push_back((uint8_t) pending);
+		pending >>= 8;
+		pending_bits -= 8;
+	}
+}
+
+void ReplayWriter::putEscape(uint64_t count) {
+	putBits(ESCAPE, 2);
+	while (count >= 8) {
+		putBits((uint32_t) (count & 7) | 8, 4);
+		count >>= 3;
+	}
+	putBits((uint32_t) count, 4);
+}
+
+void ReplayWriter::putIdle() {
+	// an escape takes 6 bits for up to 7 ticks, 10 for up to 63
+	if (idle > 3) {
+		putEscape(idle);
+	}
+	else {
+		putBits(0, 2 * (int) idle); // STRAIGHT is 0
+	}
+	idle = 0;
+}
+
+void ReplayWriter::begin(const ReplayHeader& header) {
+	bytes.clear();
+	pending = 0;
+	pending_bits = 0;
+	idle = 0;
+	ticks = 0;
+	bytes.push_back(REPLAY_VERSION);
+	putVarint(bytes, (uint64_t) header.board.width);
+	putVarint(bytes, (uint64_t) header.board.height);
+	putVarint(bytes, header.seed);
+	putVarint(bytes, header.stream);
+}
+
+void ReplayWriter::record(const Snake& snake) {
+	ticks++;
+	Action action = pendingAction(snake);
+	if (action == Action::STRAIGHT) {
+		idle++;
+		return;
+	}
+	putIdle();
+	putBits((uint32_t) action, 2);
+}
+
+void ReplayWriter::finish(const Snake& snake, GameEnd end) {
+	putIdle();
+	putEscape(0);
+	if (pending_bits > 0) {
+		putBits(0, 8 - pending_bits);
+	}
+	putVarint(bytes, ticks);
+	putVarint(bytes, (uint64_t) snake.len);
+	bytes.push_back((uint8_t) end);
+}
+
+ReplayReader::ReplayReader(const uint8_t* bytes, std::size_t count) {
+	data = bytes;
+	size = count;
+	seek(0);
+}
+
+void ReplayReader::seek(std::size_t offset) {
+	position = offset;
+	bit = 0;
+	idle = 0;
+	inputs_done = true;
+	malformed = false;
+}
+
+ReplayCursor ReplayReader::cursor() const {
+	return ReplayCursor{ position, bit, idle, inputs_done };
+}
+
+void ReplayReader::restore(const ReplayCursor& cursor) {
+	position = cursor.position;
+	bit = cursor.bit;
+	idle = cursor.idle;
+	inputs_done = cursor.inputs_done;
+	malformed = false;
+}
+
+int ReplayReader::begin(ReplayHeader& header) {
+	seek(position);
+	if (position >= size || data[position++] != REPLAY_VERSION) {
+		return 1;
+	}
+	uint64_t width;
+	uint64_t height;
+	if (getVarint(data, size, position, width) || getVarint(data, size, position, height) ||
+		getVarint(data, size, position, header.seed) || getVarint(data, size, position, header.stream)) {
+		return 1;
+	}
+	// the snake starts two cells long in the top row
+	if (width < 2 || height < 1 || width > 4096 || height > 4096) {
+		return 1;
+	}
+	header.board = BoardSize{ (int) width, (int) height };
+	inputs_done = false;
+	return 0;
+}
+
+int ReplayReader::getBits(int count, uint32_t& value) {
+	// codes and groups are an even number of bits, so a code never
+	// straddles two bytes; only a group does
+	value = 0;
+	for (int got = 0; got < count;) {
+		if (position >= size) {
+			return 1;
+		}
+		int take = std::min(count - got, 8 - bit);
+		value |= (uint32_t) ((data[position] >> bit) & ((1u << take) - 1)) << got;
+		got += take;
+		bit += take;
+		if (bit == 8) {
+			bit = 0;
+			position++;
+		}
+	}
+	return 0;
+}
+
+int ReplayReader::getEscape(uint64_t& count) {
+	count = 0;
+	for (int shift = 0; shift < 64; shift += 3) {
+		uint32_t group;
+		if (getBits(4, group)) {
+			return 1;
+		}
+		count |= (uint64_t) (group & 7) << shift;
+		if (!(group & 8)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+bool ReplayReader::nextTick(Action& action) {
+	action = Action::STRAIGHT;
+	if (idle > 0) {
+		idle--;
+		return true;
+	}
+	if (inputs_done) {
+		return false;
+	}
+	uint32_t code;
+	uint64_t count = 0;
+	if (getBits(2, code) || (code == ESCAPE && getEscape(count))) {
+		malformed = true;
+		inputs_done = true;
+		return false;
+	}
+	if (code != ESCAPE) {
+		action = (Action) code;
+		return true;
+	}
+	if (count == 0) {
+		// the result starts on the next whole byte
+		inputs_done = true;
+		if (bit != 0) {
+			bit = 0;
+			position++;
+		}
+		return false;
+	}
+	idle = count - 1;
+	return true;
+}
+
+int ReplayReader::result(ReplayResult& result) {
+	uint64_t len;
+	if (malformed || getVarint(data, size, position, result.ticks) || getVarint(data, size, position, len) ||
+		position >= size) {
+		return 1;
+	}
+	uint8_t end = data[position++];
+	if (len > (uint64_t) 4096 * 4096 || end > (uint8_t) GameEnd::TIMEOUT) {
+		return 1;
+	}
+	result.len = (int) len;
+	result.end = (GameEnd) end;
+	return 0;
+}
+
+int ReplayReader::skip() {
+	// only the codes matter, not the ticks an escape stands for
+	Action action;
+	idle = 0;
+	while (nextTick(action)) {
+		idle = 0;
+	}
+	ReplayResult ignored;
+	return result(ignored);
+}
+
+int playReplay(ReplayReader& reader, const ReplayHeader& header, Snake& snake, ReplayResult& result) {
+	snake.restart(header.seed, header.stream);
+	result.ticks = 0;
+	bool ended_early = false; // with inputs left
+	Action action;
+	while (reader.nextTick(action)) {
+		if (!snake.running) {
+			ended_early = true;
+			break;
+		}
+		snake.turn(action);
+		snake.moveOneStep();
+		result.ticks++;
+	}
+	result.len = snake.len;
+	result.end = snake.running ? GameEnd::TIMEOUT : snake.game_end;
+
+	ReplayResult recorded;
+	if (ended_early || reader.result(recorded)) {
+		return 1;
+	}
+	return recorded.ticks != result.ticks || recorded.len != result.len || recorded.end != result.end;
+}
+
+int readReplayFile(const std::filesystem::path& path, std::vector<uint8_t>& bytes) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return 1;
+	}
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return file.bad() ? 1 : 0;
+}
+
+int appendReplayFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes) {
+	std::ofstream file(path, std::ios::binary | std::ios::app);
+	if (!file) {
+		return 1;
+	}
+	file.write((const char*) bytes.data(), (std::streamsize) bytes.size());
+	return file.good() ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <filesystem>
+
+#include "Config.h"
+#include "Snake.h"
+
+// Raises the format version when games are encoded differently
+const uint8_t REPLAY_VERSION = 2;
+
+// Most ticks ReplayWriter::reserve makes room for, 4 MB of inputs: a
+// tick limit is no bound on memory
+const uint64_t REPLAY_RESERVE_TICKS = (uint64_t) 1 << 24;
+
+// What a game starts from; together with its inputs it gives the whole game
+struct ReplayHeader {
+	BoardSize board;
+	uint64_t seed;
+	uint64_t stream;
+};
+
+// How the game ended, kept to check a replay against
+struct ReplayResult {
+	uint64_t ticks;
+	int len;
+	GameEnd end;
+};
+
+/************************************************************************
+*	A game as the (seed, stream) it was started with and its inputs.	*
+*	The inputs are a stream of 2-bit codes, lowest bits of a byte		*
+*	first: the Action of every tick, or ESCAPE and then a count in		*
+*	4-bit groups, 3 bits each lowest first and the high bit set on		*
+*	every group but the last. A count n > 0 stands for n straight		*
+*	ticks, written instead of their codes when that is shorter; 0		*
+*	closes the inputs. The stream is padded with zero bits to a whole	*
+*	byte and followed by the result. Games are self-delimiting, a file	*
+*	of them is just their bytes one after another:						*
+*																		*
+*	version, width, height, seed, stream, codes..., ESCAPE, 0, padding,	*
+*	ticks, length, GameEnd												*
+************************************************************************/
+class ReplayWriter {
+private:
+	std::vector<uint8_t> bytes;
+	uint32_t pending; // bits not in bytes yet, lowest first
+	int pending_bits;
+	uint64_t idle; // straight ticks since the last turn
+	uint64_t ticks;
+
+	void putBits(uint32_t value, int count);
+	// Writes ESCAPE and count
+	void putEscape(uint64_t count);
+	// Writes the straight ticks since the last turn, the shorter way
+	void putIdle();
+
+public:
+	ReplayWriter();
+
+	// Makes room for a game of up to ticks ticks, so recording it
+	// doesn't allocate; at most REPLAY_RESERVE_TICKS, a longer game
+	// grows the buffer as it goes
+	void reserve(uint64_t ticks);
+
+	// Starts a new game, dropping the last one
+	void begin(const ReplayHeader& header);
+
+	// Call right before every Snake::moveOneStep: takes the turn that
+	// tick is going to make
+	void record(const Snake& snake);
+
+	// Closes the game; end is the snake's own unless the game was cut short
+	void finish(const Snake& snake, GameEnd end);
+
+	inline const std::vector<uint8_t>& data() const {
+		return bytes;
+	}
+};
+
+// Where a reader is inside the inputs of a game, to come back to later
+struct ReplayCursor {
+	std::size_t position;
+	int bit; // of the byte at position, 0 to 7
+	uint64_t idle;
+	bool inputs_done;
+};
+
+// Reads the games of a buffer one after another. Every call returns
+// 0 on success and 1 if the data is cut short or malformed.
+class ReplayReader {
+private:
+	const uint8_t* data;
+	std::size_t size;
+	std::size_t position;
+	int bit;
+
+	// inputs of the game being read
+	uint64_t idle; // straight ticks left of an escaped run
+	bool inputs_done;
+	bool malformed;
+
+	int getBits(int count, uint32_t& value);
+	int getEscape(uint64_t& count);
+
+public:
+	ReplayReader(const uint8_t* bytes, std::size_t count);
+
+	inline bool atEnd() const {
+		return position >= size;
+	}
+
+	inline std::size_t offset() const {
+		return position;
+	}
+
+	// Moves to a game that starts at offset, see offset()
+	void seek(std::size_t offset);
+
+	ReplayCursor cursor() const;
+
+	// Back to where cursor() was taken, in the same buffer
+	void restore(const ReplayCursor& cursor);
+
+	int begin(ReplayHeader& header);
+
+	// Input of the next tick; false once the game has no more ticks
+	bool nextTick(Action& action);
+
+	// After nextTick() gave false: how the game ended
+	int result(ReplayResult& result);
+
+	// Past the rest of the game, without playing it
+	int skip();
+};
+
+// Plays the game whose header reader has just read on snake, which
+// must be on the same board, as fast as the engine goes. result gets
+// how it ended; 1 if the data is malformed or that is not how the
+// game ended when it was recorded.
+int playReplay(ReplayReader& reader, const ReplayHeader& header, Snake& snake, ReplayResult& result);
+
+int readReplayFile(const std::filesystem::path& path, std::vector<uint8_t>& bytes);
+
+// Adds games to the end of the file, creating it if needed
+int appendReplayFile(const std::filesystem::path& path, const std::vector<uint8_t>& bytes);
+
+#endif
@@ -0,0 +1,275 @@
+#include "ReplayArchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const char ARCHIVE_MAGIC[4] = { 'S', 'N', 'K', 'A' };
+static const char INDEX_MAGIC[4] = { 'S', 'N', 'K', 'I' };
+static const uint64_t HEADER_BYTES = 8;
+static const uint64_t GAME_BYTES = 48;
+static const uint64_t KEYFRAME_BYTES = 40;
+static const uint64_t TRAILER_BYTES = 32;
+
+// count bytes of value, lowest first
+static void putBytes(std::vector<uint8_t>& bytes, uint64_t value, int count) {
+	for (int i = 0; i < count; i++) {
+		bytes.push_back((uint8_t) (value >> (8 * i)));
+	}
+}
+
+static uint64_t getBytes(const uint8_t* bytes, int count) {
+	uint64_t value = 0;
+	for (int i = 0; i < count; i++) {
+		value |= (uint64_t) bytes[i] << (8 * i);
+	}
+	return value;
+}
+
+ArchiveWriter::ArchiveWriter() : written(0), interval(KEYFRAME_INTERVAL) {
+}
+
+int ArchiveWriter::open(const std::filesystem::path& path, uint64_t keyframe_interval) {
+	if (keyframe_interval == 0) {
+		return 1;
+	}
+	interval = keyframe_interval;
+	games.clear();
+	keyframes.clear();
+	file.open(path, std::ios::binary | std::ios::trunc);
+	std::vector<uint8_t> header(ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4);
+	putBytes(header, ARCHIVE_VERSION, 4);
+	file.write((const char*) header.data(), (std::streamsize) header.size());
+	written = header.size();
+	return file.good() ? 0 : 1;
+}
+
+int ArchiveWriter::addGame(const uint8_t* replay, std::size_t size) {
+	ReplayReader reader(replay, size);
+	ReplayHeader header;
+	if (!file.is_open() || reader.begin(header)) {
+		return 1;
+	}
+	BoardSize board = header.board;
+	if (snake == nullptr || snake->getBoardSize().width != board.width ||
+		snake->getBoardSize().height != board.height) {
+		snake = std::make_unique<Snake>(nullptr, board, header.seed);
+	}
+	snake->restart(header.seed, header.stream);
+
+	ArchiveGame game;
+	game.replay_offset = written;
+	game.replay_size = size;
+	game.first_keyframe = keyframes.size();
+	game.keyframe_count = 0;
+	states.clear();
+	uint64_t every = std::max(interval, KEYFRAME_TICKS_PER_CELL * (uint64_t) board.width * board.height);
+	uint64_t ticks = 0;
+	bool ended_early = false; // with inputs left
+	Action action;
+	while (true) {
+		if (ticks > 0 && ticks % every == 0) {
+			std::size_t start = states.size();
+			snake->saveState(states);
+			ReplayCursor inputs = reader.cursor();
+			inputs.position += written;
+			// the states go right after the replay
+			keyframes.push_back(ArchiveKeyframe{ ticks, written + size + start, (uint32_t) (states.size() - start), inputs });
+			game.keyframe_count++;
+		}
+		if (!reader.nextTick(action)) {
+			break;
+		}
+		if (!snake->running) {
+			ended_early = true;
+			break;
+		}
+		snake->turn(action);
+		snake->moveOneStep();
+		ticks++;
+	}
+
+	ReplayResult recorded;
+	GameEnd end = snake->running ? GameEnd::TIMEOUT : snake->game_end;
+	if (ended_early || reader.result(recorded) || reader.offset() != size || recorded.ticks != ticks ||
+		recorded.len != snake->len || recorded.end != end) {
+		keyframes.resize(game.first_keyframe);
+		return 1;
+	}
+	game.ticks = ticks;
+	game.len = snake->len;
+	game.board = board;
+	game.end = end;
+	games.push_back(game);
+
+	file.write((const char*) replay, (std::streamsize) size);
+	file.write((const char*) states.data(), (std::streamsize) states.size());
+	written += size + states.size();
+	return file.good() ? 0 : 1;
+}
+
+int ArchiveWriter::finish() {
+	index.clear();
+	for (const ArchiveGame& game : games) {
+		putBytes(index, game.replay_offset, 8);
+		putBytes(index, game.replay_size, 8);
+		putBytes(index, game.first_keyframe, 8);
+		putBytes(index, game.ticks, 8);
+		putBytes(index, game.keyframe_count, 4);
+		putBytes(index, (uint64_t) game.len, 4);
+		putBytes(index, (uint64_t) game.board.width, 2);
+		putBytes(index, (uint64_t) game.board.height, 2);
+		putBytes(index, (uint64_t) game.end, 1);
+		putBytes(index, 0, 3);
+	}
+	for (const ArchiveKeyframe& keyframe : keyframes) {
+		putBytes(index, keyframe.tick, 8);
+		putBytes(index, keyframe.state_offset, 8);
+		putBytes(index, keyframe.inputs.position, 8);
+		putBytes(index, keyframe.inputs.idle, 8);
+		putBytes(index, keyframe.state_size, 4);
+		putBytes(index, (uint64_t) keyframe.inputs.bit, 1);
+		putBytes(index, keyframe.inputs.inputs_done, 1);
+		putBytes(index, 0, 2);
+	}
+	putBytes(index, written, 8);
+	putBytes(index, games.size(), 8);
+	putBytes(index, keyframes.size(), 8);
+	index.insert(index.end(), INDEX_MAGIC, INDEX_MAGIC + 4);
+	putBytes(index, ARCHIVE_VERSION, 4);
+	file.write((const char*) index.data(), (std::streamsize) index.size());
+	file.close();
+	return file.good() ? 0 : 1;
+}
+
+ArchiveReader::ArchiveReader() : index_offset(0), game_count(0), keyframe_count(0) {
+}
+
+int ArchiveReader::open(const std::filesystem::path& path) {
+	game_count = 0;
+	keyframe_count = 0;
+	if (file.open(path)) {
+		return 1;
+	}
+	const uint8_t* bytes = file.data();
+	uint64_t size = file.size();
+	if (size < HEADER_BYTES + TRAILER_BYTES || std::memcmp(bytes, ARCHIVE_MAGIC, 4) != 0 ||
+		getBytes(bytes + 4, 4) != ARCHIVE_VERSION) {
+		return 1;
+	}
+	const uint8_t* trailer = bytes + size - TRAILER_BYTES;
+	uint64_t offset = getBytes(trailer, 8);
+	uint64_t games = getBytes(trailer + 8, 8);
+	uint64_t keyframes = getBytes(trailer + 16, 8);
+	if (std::memcmp(trailer + 24, INDEX_MAGIC, 4) != 0 || getBytes(trailer + 28, 4) != ARCHIVE_VERSION ||
+		offset < HEADER_BYTES || games > size / GAME_BYTES || keyframes > size / KEYFRAME_BYTES ||
+		offset + games * GAME_BYTES + keyframes * KEYFRAME_BYTES + TRAILER_BYTES != size) {
+		return 1;
+	}
+	index_offset = offset;
+	game_count = games;
+	keyframe_count = keyframes;
+	file.advise(0, file.size(), MappedFile::Access::RANDOM);
+	return 0;
+}
+
+void ArchiveReader::adviseScan() const {
+	ArchiveGame info;
+	for (uint64_t i = 0; i < game_count; i++) {
+		if (game(i, info) == 0) {
+			file.advise((std::size_t) info.replay_offset, (std::size_t) info.replay_size, MappedFile::Access::SEQUENTIAL);
+		}
+	}
+}
+
+int ArchiveReader::game(uint64_t i, ArchiveGame& game) const {
+	if (i >= game_count) {
+		return 1;
+	}
+	const uint8_t* entry = file.data() + index_offset + i * GAME_BYTES;
+	game.replay_offset = getBytes(entry, 8);
+	game.replay_size = getBytes(entry + 8, 8);
+	game.first_keyframe = getBytes(entry + 16, 8);
+	game.ticks = getBytes(entry + 24, 8);
+	game.keyframe_count = (uint32_t) getBytes(entry + 32, 4);
+	game.len = (int) getBytes(entry + 36, 4);
+	game.board = BoardSize{ (int) getBytes(entry + 40, 2), (int) getBytes(entry + 42, 2) };
+	uint8_t end = entry[44];
+	if (game.replay_offset < HEADER_BYTES || game.replay_offset > index_offset ||
+		game.replay_size > index_offset - game.replay_offset || game.first_keyframe > keyframe_count ||
+		game.keyframe_count > keyframe_count - game.first_keyframe || end > (uint8_t) GameEnd::TIMEOUT) {
+		return 1;
+	}
+	game.end = (GameEnd) end;
+	return 0;
+}
+
+int ArchiveReader::keyframe(uint64_t i, ArchiveKeyframe& keyframe) const {
+	const uint8_t* entry = file.data() + index_offset + game_count * GAME_BYTES + i * KEYFRAME_BYTES;
+	keyframe.tick = getBytes(entry, 8);
+	keyframe.state_offset = getBytes(entry + 8, 8);
+	keyframe.inputs.position = (std::size_t) getBytes(entry + 16, 8);
+	keyframe.inputs.idle = getBytes(entry + 24, 8);
+	keyframe.state_size = (uint32_t) getBytes(entry + 32, 4);
+	uint8_t bit = entry[36];
+	keyframe.inputs.bit = bit;
+	keyframe.inputs.inputs_done = entry[37] & 1;
+	if (keyframe.state_offset > index_offset || keyframe.state_size > index_offset - keyframe.state_offset ||
+		keyframe.inputs.position > index_offset || bit > 7) {
+		return 1;
+	}
+	return 0;
+}
+
+int ArchiveReader::seek(uint64_t game_index, uint64_t tick, Snake& snake, ReplayReader& reader) const {
+	ArchiveGame info;
+	if (game(game_index, info) || tick > info.ticks || snake.getBoardSize().width != info.board.width ||
+		snake.getBoardSize().height != info.board.height) {
+		return 1;
+	}
+
+	// the last keyframe at or before tick
+	uint32_t low = 0;
+	uint32_t high = info.keyframe_count;
+	ArchiveKeyframe closest;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (keyframe(info.first_keyframe + middle, closest)) {
+			return 1;
+		}
+		if (closest.tick <= tick) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	uint64_t at = 0;
+	if (low > 0) {
+		if (keyframe(info.first_keyframe + low - 1, closest) ||
+			snake.loadState(file.data() + closest.state_offset, closest.state_size)) {
+			return 1;
+		}
+		reader.restore(closest.inputs);
+		at = closest.tick;
+	}
+	else {
+		ReplayHeader header;
+		reader.seek((std::size_t) info.replay_offset);
+		if (reader.begin(header) || header.board.width != info.board.width ||
+			header.board.height != info.board.height) {
+			return 1;
+		}
+		snake.restart(header.seed, header.stream);
+	}
+
+	Action action;
+	for (; at < tick; at++) {
+		if (!snake.running || !reader.nextTick(action)) {
+			return 1;
+		}
+		snake.turn(action);
+		snake.moveOneStep();
+	}
+	return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef REPLAY_ARCHIVE_H
+#define REPLAY_ARCHIVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+
+#include "Config.h"
+#include "Snake.h"
+#include "Replay.h"
+#include "MappedFile.h"
+
+const uint32_t ARCHIVE_VERSION = 2;
+
+// Ticks between two keyframes of a game: at most this many ticks are
+// replayed to reach any tick
+const uint64_t KEYFRAME_INTERVAL = 1024;
+// A keyframe takes a few bytes per cell of the board, nearly all of it
+// the free cells (see Snake::saveState), while a replay takes less than
+// a byte per tick. On big boards keyframes are this many ticks per cell
+// apart instead, so they take about as much as the replay.
+const uint64_t KEYFRAME_TICKS_PER_CELL = 8;
+
+// What the index knows about one game of an archive
+struct ArchiveGame {
+	uint64_t replay_offset; // where its replay starts in the file
+	uint64_t replay_size;
+	uint64_t first_keyframe; // in the keyframe table of the index
+	uint32_t keyframe_count;
+	uint64_t ticks;
+	int len;
+	BoardSize board;
+	GameEnd end;
+};
+
+// The game at one tick: a Snake::saveState blob and where the replay
+// goes on from there
+struct ArchiveKeyframe {
+	uint64_t tick;
+	uint64_t state_offset;
+	uint32_t state_size;
+	ReplayCursor inputs; // position counted from the start of the file
+};
+
+/************************************************************************
+*	Many games in one file, any tick of any of them a seek away. Every	*
+*	game is its replay (see Replay.h) followed by the full state of the	*
+*	game every KEYFRAME_INTERVAL ticks, or KEYFRAME_TICKS_PER_CELL		*
+*	ticks per cell if that is more. After the games comes an index of	*
+*	fixed-size records, so it is read in place:							*
+*																		*
+*	"SNKA", version														*
+*	per game: replay, keyframe states...								*
+*	per game: replay offset, replay size, first keyframe, ticks,		*
+*		keyframe count, length, width, height, GameEnd (48 bytes)		*
+*	per keyframe: tick, state offset, input position, idle,				*
+*		state size, input bit, inputs done (40 bytes)					*
+*	index offset, game count, keyframe count, "SNKI", version			*
+*																		*
+*	All numbers are little endian. Tick 0 of a game has no keyframe,	*
+*	it is the start of the replay.										*
+************************************************************************/
+class ArchiveWriter {
+private:
+	std::ofstream file;
+	uint64_t written;
+	uint64_t interval;
+	std::vector<ArchiveGame> games;
+	std::vector<ArchiveKeyframe> keyframes;
+	std::vector<uint8_t> states; // of the game being added
+	std::vector<uint8_t> index;
+	std::unique_ptr<Snake> snake;
+
+public:
+	ArchiveWriter();
+
+	// keyframe_interval is the fewest ticks between keyframes, on boards
+	// too small for KEYFRAME_TICKS_PER_CELL to space them further
+	int open(const std::filesystem::path& path, uint64_t keyframe_interval = KEYFRAME_INTERVAL);
+
+	// Adds the game of size bytes of replay, playing it to take the
+	// keyframes; 1 if it is malformed, doesn't end the way it was
+	// recorded or the file can't be written
+	int addGame(const uint8_t* replay, std::size_t size);
+
+	// Writes the index; the archive is only readable after this
+	int finish();
+};
+
+// Reads an archive through a memory mapping: replays and keyframes are
+// played straight from the mapped file
+class ArchiveReader {
+private:
+	MappedFile file;
+	uint64_t index_offset;
+	uint64_t game_count;
+	uint64_t keyframe_count;
+
+	int keyframe(uint64_t i, ArchiveKeyframe& keyframe) const;
+
+public:
+	ArchiveReader();
+
+	// 1 if the file isn't a whole archive. The file is read as for
+	// seeks, a few pages at a time from anywhere.
+	int open(const std::filesystem::path& path);
+
+	// Has the replays read ahead, for playing every game through; the
+	// keyframes between them are still only read where seeks land
+	void adviseScan() const;
+
+	inline uint64_t gameCount() const {
+		return game_count;
+	}
+
+	// 1 if the index entry points outside the file
+	int game(uint64_t i, ArchiveGame& game) const;
+
+	// The whole file, for a ReplayReader; the replays are where
+	// game() says
+	inline const uint8_t* data() const {
+		return file.data();
+	}
+
+	inline std::size_t size() const {
+		return file.size();
+	}
+
+	// Puts snake, which must be on the board of the game, where the game
+	// was after tick ticks, from the closest keyframe before it. reader
+	// must read data(); it is left at the next input, so playing on with
+	// nextTick() continues the game. 1 if the tick is past the end of
+	// the game or the data is malformed.
+	int seek(uint64_t game, uint64_t tick, Snake& snake, ReplayReader& reader) const;
+};
+
+#endif
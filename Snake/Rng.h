@@ -0,0 +1,70 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+/************************************************************************
+*	Counter-based generator: the n-th output is the SplitMix64 mix of	*
+*	the n-th step of a Weyl sequence. Skipping ahead is one multiply	*
+*	and every (seed, stream) pair gets its own run of 2^40 outputs		*
+*	that never overlaps another stream of the same seed.				*
+************************************************************************/
+class Rng {
+private:
+	static const uint64_t GAMMA = 0x9e3779b97f4a7c15ULL;
+	static const uint64_t STREAM_LENGTH = (uint64_t) 1 << 40;
+
+	uint64_t counter;
+
+	static inline uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+public:
+	Rng(uint64_t seed = 0, uint64_t stream = 0) {
+		reseed(seed, stream);
+	}
+
+	inline void reseed(uint64_t seed, uint64_t stream = 0) {
+		counter = mix(seed) + stream * STREAM_LENGTH * GAMMA;
+	}
+
+	inline uint64_t next() {
+		counter += GAMMA;
+		return mix(counter);
+	}
+
+	// Same as calling next() n times
+	inline void jump(uint64_t n) {
+		counter += n * GAMMA;
+	}
+
+	// Uniform in [0, bound), bound > 0 (Lemire's method, no modulo bias)
+	inline uint32_t below(uint32_t bound) {
+		uint64_t m = (uint64_t) (uint32_t) next() * bound;
+		if ((uint32_t) m < bound) {
+			uint32_t threshold = (0u - bound) % bound;
+			while ((uint32_t) m < threshold) {
+				m = (uint64_t) (uint32_t) next() * bound;
+			}
+		}
+		return (uint32_t) (m >> 32);
+	}
+
+	// Uniform in [0, 1)
+	inline float nextFloat() {
+		return (float) (next() >> 40) * (1.0f / 16777216.0f);
+	}
+
+	inline uint64_t getState() const {
+		return counter;
+	}
+
+	inline void setState(uint64_t state) {
+		counter = state;
+	}
+};
+
+#endif
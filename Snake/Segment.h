@@ -2,7 +2,9 @@
 #ifndef SEGMENT_H
 #define SEGMENT_H
 
-#include "Paint.h"
+#include <cstdint>
+
+#include "CommandBuffer.h"
 
 class Segment {
 public:
@@ -12,15 +14,13 @@ public:
 	int x;
 	int y;
 
-	float red;
-	float green;
-	float blue;
-
-	Segment(int prev, int next, int x_cord, int y_cord, float r, float g, float b);
+	uint8_t color; // palette index
 
-	HRESULT draw(Paint* paint);
+	Segment(int prev, int next, int x_cord, int y_cord, uint8_t c);
 
-	int move(int prev);
+	// Curved segments only; straight ones are drawn in runs, see
+	// Snake::recordRun
+	void record(CommandBuffer& commands) const;
 };
 
 
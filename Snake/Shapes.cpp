@@ -0,0 +1,36 @@
+#include "Shapes.h"
+
+const ShapePath SHAPE_PATHS[SHAPE_COUNT] = {
+	// SHAPE_STRAIGHT
+	{ { 300.0f, 300.0f }, 4, {
+		{ false, { { 300.0f, 400.0f } } },
+		{ true, { { 333.0f, 450.0f }, { 367.0f, 350.0f }, { 400.0f, 400.0f } } },
+		{ false, { { 400.0f, 300.0f } } },
+		{ true, { { 367.0f, 250.0f }, { 333.0f, 350.0f }, { 300.0f, 300.0f } } }
+	} },
+	// SHAPE_CURVED
+	{ { 400.0f, 300.0f }, 3, {
+		{ true, { { 350.0f, 333.0f }, { 450.0f, 367.0f }, { 400.0f, 400.0f } } },
+		{ true, { { 367.0f, 350.0f }, { 333.0f, 450.0f }, { 300.0f, 400.0f } } },
+		{ true, { { 300.0f, 300.0f }, { 300.0f, 300.0f }, { 400.0f, 300.0f } } }
+	} },
+	// SHAPE_HEAD
+	{ { 400.0f, 300.0f }, 5, {
+		{ true, { { 350.0f, 333.0f }, { 450.0f, 367.0f }, { 400.0f, 400.0f } } },
+		{ true, { { 375.0f, 388.0f }, { 375.0f, 388.0f }, { 300.0f, 375.0f } } },
+		{ false, { { 350.0f, 350.0f } } },
+		{ false, { { 300.0f, 325.0f } } },
+		{ true, { { 312.0f, 325.0f }, { 312.0f, 325.0f }, { 400.0f, 300.0f } } }
+	} },
+	// SHAPE_TAIL
+	{ { 400.0f, 300.0f }, 3, {
+		{ true, { { 350.0f, 333.0f }, { 450.0f, 367.0f }, { 400.0f, 400.0f } } },
+		{ true, { { 325.0f, 375.0f }, { 325.0f, 375.0f }, { 300.0f, 350.0f } } },
+		{ true, { { 325.0f, 325.0f }, { 325.0f, 325.0f }, { 400.0f, 300.0f } } }
+	} },
+	// SHAPE_EATING_PARTICLE
+	{ { 370.0f, 300.0f }, 2, {
+		{ false, { { 400.0f, 330.0f } } },
+		{ true, { { 400.0f, 300.0f }, { 400.0f, 300.0f }, { 390.0f, 300.0f } } }
+	} }
+};
@@ -0,0 +1,46 @@
+#ifndef SHAPES_H
+#define SHAPES_H
+
+#include "RenderSink.h"
+
+/************************************************************************
+*	Outlines of everything drawn inside a cell, shared by all			*
+*	renderers. They live in a 100 x 100 box from (300, 300) to			*
+*	(400, 400); a renderer scales that box to a cell and rotates it		*
+*	around SHAPE_CENTER in quarter turns.								*
+************************************************************************/
+enum Shape {
+	SHAPE_STRAIGHT,
+	SHAPE_CURVED,
+	SHAPE_HEAD,
+	SHAPE_TAIL,
+	SHAPE_EATING_PARTICLE,
+	SHAPE_COUNT
+};
+
+struct ShapePoint {
+	float x;
+	float y;
+};
+
+struct ShapeCommand {
+	bool bezier; // a cubic Bezier through points[0..2], otherwise a line to points[0]
+	ShapePoint points[3];
+};
+
+// One closed, filled figure
+struct ShapePath {
+	ShapePoint start;
+	int count;
+	ShapeCommand commands[5];
+};
+
+const ShapePoint SHAPE_CENTER = { 350.0f, 350.0f };
+const float SHAPE_SIZE = 100.0f;
+
+const Color HEAD_COLOR = { 0.5f, 1.0f, 0.5f };
+const Color TAIL_COLOR = { 0.5f, 0.25f, 0.0f };
+
+extern const ShapePath SHAPE_PATHS[SHAPE_COUNT];
+
+#endif
@@ -1,72 +1,475 @@
 #include "Snake.h"
+#include "Profiler.h"
+#include "Varint.h"
 
+#include <algorithm>
+#include <cstring>
 
-Snake::Snake(Paint * p) {
+
+// a frame never holds more commands than cells, plus the candy and the
+// eating animation
+static int commandCapacity(BoardSize size) {
+	return size.width * size.height + 2;
+}
+
+// body indices next to the changed cells, see recordNear
+static const int NEARBY_CAPACITY = ChangeSet::MAX_CELLS * 9;
+
+Snake::Snake(RenderSink* s, BoardSize size, uint64_t seed, uint64_t stream) : arena(arenaSize(size, s != nullptr)),
+	body(size.width * size.height, &arena), occupancy(size.width, size.height, &arena),
+	free_cells(size.width * size.height, &arena), rng(seed, stream),
+	commands(s != nullptr ? commandCapacity(size) : 0, &arena), body_slot(size.width * size.height, &arena),
+	nearby(&arena) {
+	sink = s;
+	width = size.width;
+	height = size.height;
+	step_function = selectStep(size);
+	if (sink != nullptr) {
+		nearby.reserve(NEARBY_CAPACITY);
+	}
 	this->restart();
-	paint = p;
+}
+
+Snake::Snake(const Snake& other) : Snake(other.sink, other.getBoardSize(), 0) {
+	*this = other;
+}
+
+Snake& Snake::operator=(const Snake& other) {
+	body = other.body;
+	occupancy = other.occupancy;
+	free_cells = other.free_cells;
+	rng = other.rng;
+	updateSlots();
+	candy_color = other.candy_color;
+	eating_animation_color = other.eating_animation_color;
+	running = other.running;
+	game_end = other.game_end;
+	len = other.len;
+	orientation = other.orientation;
+	new_orientation = other.new_orientation;
+	orientation_changed = other.orientation_changed;
+	eating_animation = other.eating_animation;
+	candy = other.candy;
+	changes.markAll();
+	return *this;
+}
+
+// body_slot is only read by draw(), so headless games leave it as it is
+void Snake::updateSlots() {
+	if (sink == nullptr) {
+		return;
+	}
+	// only the cells under the snake are ever looked up
+	for (int i = 0; i < body.size(); i++) {
+		const Body::Cell& cell = body.at(i);
+		body_slot[cell.x * width + cell.y] = body.slotOf(i);
+	}
+}
+
+std::unique_ptr<Snake> Snake::fork() const {
+	std::unique_ptr<Snake> copy = std::make_unique<Snake>(nullptr, getBoardSize(), 0);
+	*copy = *this;
+	return copy;
+}
+
+std::size_t Snake::arenaSize(BoardSize size, bool drawn) {
+	int cells = size.width * size.height;
+	return Body::arenaBytes(cells) + Grid::arenaBytes(size.width, size.height) + FreeCells::arenaBytes(cells) +
+		CommandBuffer::arenaBytes(drawn ? commandCapacity(size) : 0) + Arena::bytesFor<unsigned int>(cells) +
+		(drawn ? Arena::bytesFor<int>(NEARBY_CAPACITY) : 0);
+}
+
+SnakeSnapshot::SnakeSnapshot(BoardSize size) : used(0) {
+	int cells = size.width * size.height;
+	bytes.resize(sizeof(Snake::Fields) + Body::snapshotBytes(cells) + Grid::snapshotBytes(size.width, size.height) +
+		FreeCells::snapshotBytes(cells));
+}
+
+SnakeSnapshot& SnakeSnapshot::operator=(const SnakeSnapshot& other) {
+	std::memcpy(bytes.data(), other.bytes.data(), other.used);
+	used = other.used;
+	return *this;
+}
+
+void Snake::snapshot(SnakeSnapshot& snapshot) const {
+	Fields fields{ running, game_end, len, orientation, new_orientation, orientation_changed, eating_animation,
+		candy.first, candy.second, candy_color, eating_animation_color, rng };
+	std::byte* out = snapshot.bytes.data();
+	std::memcpy(out, &fields, sizeof(fields));
+	out += sizeof(fields);
+	body.save(out);
+	occupancy.save(out);
+	free_cells.save(out);
+	snapshot.used = (std::size_t) (out - snapshot.bytes.data());
+}
+
+void Snake::restore(const SnakeSnapshot& snapshot) {
+	Fields fields;
+	const std::byte* in = snapshot.bytes.data();
+	std::memcpy(&fields, in, sizeof(fields));
+	in += sizeof(fields);
+	body.load(in);
+	occupancy.load(in);
+	free_cells.load(in);
+	updateSlots();
+
+	running = fields.running;
+	game_end = fields.game_end;
+	len = fields.len;
+	orientation = fields.orientation;
+	new_orientation = fields.new_orientation;
+	orientation_changed = fields.orientation_changed;
+	eating_animation = fields.eating_animation;
+	candy = std::pair<int, int>(fields.candy_x, fields.candy_y);
+	candy_color = fields.candy_color;
+	eating_animation_color = fields.eating_animation_color;
+	rng = fields.rng;
+	changes.markAll();
+}
+
+// Boards we run most often get their own copy of the tick, where the
+// index math folds into constants; every other size takes the generic one
+Snake::StepFunction Snake::selectStep(BoardSize size) {
+	if (size.width == 10 && size.height == 10) {
+		return &Snake::moveOneStepOn<10, 10>;
+	}
+	if (size.width == 20 && size.height == 20) {
+		return &Snake::moveOneStepOn<20, 20>;
+	}
+	if (size.width == 40 && size.height == 20) {
+		return &Snake::moveOneStepOn<40, 20>;
+	}
+	if (size.width == 64 && size.height == 64) {
+		return &Snake::moveOneStepOn<64, 64>;
+	}
+	return &Snake::moveOneStepOn<0, 0>;
 }
 
 void Snake::restart() {
 	orientation = 1;
 	new_orientation = orientation;
 	orientation_changed = false;
-	tail_orientation = 1;
 	len = 2;
 	eating_animation = false;
 
-	head_cords = std::pair<int, int>(0, 1);
-	tail_cords = std::pair<int, int>(0, 0);
+	std::pair<int, int> head_cords = std::pair<int, int>(0, 1);
+	std::pair<int, int> tail_cords = std::pair<int, int>(0, 0);
 
-	segments.clear();
+	body.clear();
+	pushHead(tail_cords.first, tail_cords.second);
+	pushHead(head_cords.first, head_cords.second);
 
 	running = true;
-	for (int x = 0; x < GRID_HEIGHT; x++) {
-		for (int y = 0; y < GRID_WIDTH; y++) {
-			if (!(x == head_cords.first && y == head_cords.second) &&
-				!(x == tail_cords.first && y == tail_cords.second)) {
-				freeSpots.insert(std::pair<int, int>(x, y));
-			}
+	game_end = GameEnd::NONE;
+	occupancy.clear();
+	free_cells.fill();
+	occupy<0, 0>(tail_cords.first, tail_cords.second);
+	occupy<0, 0>(head_cords.first, head_cords.second);
+	randomizeCandy<0, 0>();
+	changes.markAll();
+}
+
+void Snake::restart(uint64_t seed, uint64_t stream) {
+	rng.reseed(seed, stream);
+	restart();
+}
+
+/************************************************************************
+*	A saved state: width, height and length as varints, then one byte	*
+*	of orientations and flags, the GameEnd, the candy (each coordinate	*
+*	plus one, -1 means none) and the two colors, the Rng as 8 bytes		*
+*	lowest first, the tail cell and for every cell from the tail to		*
+*	the head the orientation it was entered with and its color. Last	*
+*	the free cells: how many, then every cell id in FreeCells order,	*
+*	as candy placement depends on that order.							*
+************************************************************************/
+void Snake::saveState(std::vector<uint8_t>& bytes) const {
+	putVarint(bytes, (uint64_t) width);
+	putVarint(bytes, (uint64_t) height);
+	putVarint(bytes, (uint64_t) len);
+	bytes.push_back((uint8_t) (orientation | new_orientation << 2 | orientation_changed << 4 |
+		eating_animation << 5 | running << 6));
+	bytes.push_back((uint8_t) game_end);
+	putVarint(bytes, (uint64_t) (candy.first + 1));
+	putVarint(bytes, (uint64_t) (candy.second + 1));
+	bytes.push_back(candy_color);
+	bytes.push_back(eating_animation ? eating_animation_color : 0); // left over otherwise
+	uint64_t state = rng.getState();
+	for (int i = 0; i < 8; i++) {
+		bytes.push_back((uint8_t) (state >> (8 * i)));
+	}
+	putVarint(bytes, (uint64_t) body.back().x);
+	putVarint(bytes, (uint64_t) body.back().y);
+	for (int i = body.size() - 1; i >= 0; i--) {
+		bytes.push_back(body.at(i).dir);
+		// the head and the tail have no color of their own, their slots
+		// hold whatever was there before
+		bytes.push_back(i > 0 && i < body.size() - 1 ? body.segmentColor(i) : 0);
+	}
+	putVarint(bytes, (uint64_t) free_cells.size());
+	for (int i = 0; i < free_cells.capacity(); i++) {
+		putVarint(bytes, (uint64_t) free_cells.at(i));
+	}
+}
+
+int Snake::loadState(const uint8_t* bytes, std::size_t size) {
+	std::size_t position = 0;
+	auto get = [&](uint64_t& value) {
+		return getVarint(bytes, size, position, value);
+	};
+	auto getByte = [&](uint8_t& value) {
+		if (position >= size) {
+			return 1;
 		}
+		value = bytes[position++];
+		return 0;
+	};
+	int cells = width * height;
+	uint64_t w, h, length, candy_x, candy_y;
+	uint8_t flags, end, colors[2];
+	if (get(w) || get(h) || w != (uint64_t) width || h != (uint64_t) height || get(length) ||
+		length < 2 || length > (uint64_t) cells || getByte(flags) || getByte(end) ||
+		end > (uint8_t) GameEnd::TIMEOUT || get(candy_x) || get(candy_y) ||
+		candy_x > (uint64_t) height || candy_y > (uint64_t) width || getByte(colors[0]) || getByte(colors[1]) ||
+		size - position < 8) {
+		return 1;
+	}
+	uint64_t state = 0;
+	for (int i = 0; i < 8; i++) {
+		state |= (uint64_t) bytes[position++] << (8 * i);
 	}
-	randomizeCandy();
+
+	uint64_t tail_x, tail_y;
+	if (get(tail_x) || get(tail_y) || tail_x >= (uint64_t) height || tail_y >= (uint64_t) width) {
+		return 1;
+	}
+	body.clear();
+	occupancy.clear();
+	std::pair<int, int> cell((int) tail_x, (int) tail_y);
+	for (uint64_t i = 0; i < length; i++) {
+		uint8_t dir, color;
+		if (getByte(dir) || getByte(color) || dir > 3) {
+			return 1;
+		}
+		if (i > 0) {
+			cell = step(cell, dir);
+		}
+		if (cell.first < 0 || cell.first >= height || cell.second < 0 || cell.second >= width ||
+			occupancy.isOccupied(cell.first, cell.second)) {
+			return 1;
+		}
+		body.pushHead(cell.first, cell.second, dir);
+		body.setSegmentColor(0, color);
+		body_slot[cell.first * width + cell.second] = body.headSlot();
+		occupancy.occupy(cell.first, cell.second);
+	}
+
+	uint64_t free_count;
+	if (get(free_count) || free_count > (uint64_t) cells) {
+		return 1;
+	}
+	bool bad_cell = false;
+	free_cells.restore((int) free_count, [&]() {
+		uint64_t id;
+		if (get(id) || id >= (uint64_t) cells) {
+			bad_cell = true;
+			return 0;
+		}
+		return (int) id;
+	});
+	if (bad_cell || !free_cells.isPermutation()) {
+		return 1;
+	}
+	// exactly the cells off the body are free, or candies would land on
+	// it; a move that ran into something has already let go of the tail
+	bool playing = (flags >> 6) & 1;
+	if (playing && free_count != (uint64_t) (cells - length)) {
+		return 1;
+	}
+	for (int i = 0; playing && i < (int) free_count; i++) {
+		int id = free_cells.at(i);
+		if (occupancy.isOccupied(id / width, id % width)) {
+			return 1;
+		}
+	}
+	if ((candy_x == 0) != (candy_y == 0) || (candy_x > 0 && occupancy.isOccupied((int) candy_x - 1, (int) candy_y - 1))) {
+		return 1;
+	}
+
+	len = (int) length;
+	orientation = flags & 3;
+	new_orientation = (flags >> 2) & 3;
+	orientation_changed = (flags >> 4) & 1;
+	eating_animation = (flags >> 5) & 1;
+	running = (flags >> 6) & 1;
+	game_end = (GameEnd) end;
+	candy = std::pair<int, int>((int) candy_x - 1, (int) candy_y - 1);
+	candy_color = colors[0];
+	eating_animation_color = colors[1];
+	rng.setState(state);
+	changes.markAll();
+	return 0;
+}
+
+void Snake::pushHead(int x, int y) {
+	body.pushHead(x, y, orientation);
+	body_slot[x * width + y] = body.headSlot();
+}
+
+void Snake::recordSegment(int i) {
+	const Body::Cell& cell = body.at(i);
+	// the segment closer to the head sits where this one was left through
+	Segment segment(body.at(i - 1).dir, (cell.dir + 2) % 4, cell.x, cell.y, body.segmentColor(i));
+	segment.record(commands);
 }
 
-HRESULT Snake::draw() {
-	HRESULT hr;
-	for (Segment& segment : segments) {
-		hr = segment.draw(paint);
-		if (FAILED(hr)) {
-			return hr;
+// Whether body segment i goes on in the direction it came from
+bool Snake::isStraight(int i) const {
+	return body.at(i - 1).dir == body.at(i).dir;
+}
+
+// Straight segments first..last (first closer to the head) as one run,
+// starting from the tail end
+void Snake::recordRun(int first, int last) {
+	const Body::Cell& start = body.at(last);
+	commands.beginRun(start.x, start.y, start.dir);
+	for (int i = last; i >= first; i--) {
+		commands.extendRun(body.segmentColor(i));
+	}
+}
+
+// Whatever is drawn after the segments, in the same order for full and
+// partial frames so both give the same picture
+void Snake::recordEnds(bool head, bool tail, bool candy_visible) {
+	const Body::Cell& front = body.front();
+	if (head) {
+		commands.record(DRAW_HEAD, front.x, front.y, orientation, 0);
+	}
+	if (tail) {
+		const Body::Cell& back = body.back();
+		commands.record(DRAW_TAIL, back.x, back.y, body.at(body.size() - 2).dir, 0);
+	}
+	if (head && eating_animation) {
+		commands.record(DRAW_EATING_ANIMATION, front.x, front.y, orientation, eating_animation_color);
+	}
+	if (candy_visible) {
+		commands.record(DRAW_CANDY, candy.first, candy.second, 0, candy_color);
+	}
+}
+
+void Snake::recordAll() {
+	int tail = body.size() - 1;
+	for (int i = 1; i < tail; i++) {
+		if (!isStraight(i)) {
+			recordSegment(i);
+			continue;
+		}
+		int last = i;
+		while (last + 1 < tail && isStraight(last + 1)) {
+			last++;
 		}
+		recordRun(i, last);
+		i = last;
 	}
-	hr = paint->drawHead(head_cords.first, head_cords.second, orientation);
-	if (FAILED(hr)) {
-		return hr;
+	recordEnds(true, true, candy.first >= 0); // no candy once the board is full
+}
+
+// Shapes spill a little over their cell, so a changed cell is repainted
+// together with everything on the eight cells around it. A straight run
+// is drawn whole, so it gives the same pixels as in a full frame.
+void Snake::recordNear() {
+	nearby.clear();
+	bool candy_near = false;
+	const ChangeSet& dirty = commands.getDirty();
+	for (int c = 0; c < dirty.size(); c++) {
+		for (int x = dirty.at(c).first - 1; x <= dirty.at(c).first + 1; x++) {
+			for (int y = dirty.at(c).second - 1; y <= dirty.at(c).second + 1; y++) {
+				if (x < 0 || x >= height || y < 0 || y >= width) {
+					continue;
+				}
+				if (occupancy.isOccupied(x, y)) {
+					nearby.push_back(body.indexOf(body_slot[x * width + y]));
+				}
+				if (candy.first == x && candy.second == y) {
+					candy_near = true;
+				}
+			}
+		}
 	}
-	hr = paint->drawTail(tail_cords.first, tail_cords.second, tail_orientation);
-	if (FAILED(hr)) {
-		return hr;
+	std::sort(nearby.begin(), nearby.end());
+	nearby.erase(std::unique(nearby.begin(), nearby.end()), nearby.end());
+
+	int tail = body.size() - 1;
+	int recorded = 0; // segments up to here are done
+	for (int i : nearby) {
+		if (i < 1 || i >= tail || i <= recorded) {
+			continue;
+		}
+		if (!isStraight(i)) {
+			recordSegment(i);
+			continue;
+		}
+		int first = i;
+		while (first > 1 && isStraight(first - 1)) {
+			first--;
+		}
+		recorded = i;
+		while (recorded + 1 < tail && isStraight(recorded + 1)) {
+			recorded++;
+		}
+		recordRun(first, recorded);
+	}
+	bool head_near = !nearby.empty() && nearby.front() == 0;
+	bool tail_near = !nearby.empty() && nearby.back() == tail;
+	recordEnds(head_near, tail_near, candy_near);
+}
+
+int Snake::draw() {
+	if (sink == nullptr) {
+		return 0;
 	}
-	if (eating_animation) {
-		hr = drawEatingAnimation();
-		if (FAILED(hr)) {
-			return hr;
+	{
+		PROFILE_SCOPE(PHASE_DRAW);
+		if (!sink->keepsLastFrame()) {
+			changes.markAll();
+		}
+		commands.clear(changes);
+		changes.clear();
+		if (commands.getDirty().isAll()) {
+			recordAll();
+		}
+		else {
+			recordNear();
 		}
 	}
-	drawCandy();
-	return S_OK;
+	PROFILE_SCOPE(PHASE_SUBMIT);
+	return sink->drawCommands(commands);
+}
+
+void Snake::invalidate() {
+	changes.markAll();
+}
+
+const ChangeSet& Snake::getChanges() const {
+	return changes;
 }
 
-bool checkIfOutOfBounds(const std::pair<int, int>& p) {
-	if (p.first < 0 || p.first >= GRID_HEIGHT || p.second < 0 || p.second >= GRID_WIDTH) {
-		return true;
+void Snake::turn(Action action) {
+	if (orientation_changed || action == Action::STRAIGHT) {
+		return;
 	}
-	return false;
+	if (action == Action::RIGHT) {
+		new_orientation = (orientation + 1) % 4;
+	}
+	else {
+		new_orientation = (orientation + 3) % 4;
+	}
+	orientation_changed = true;
 }
 
-std::pair<int, int> Snake::determineNewCords() {
-	int new_x = head_cords.first;
-	int new_y = head_cords.second;
+std::pair<int, int> Snake::step(const std::pair<int, int>& p, int orientation) {
+	int new_x = p.first;
+	int new_y = p.second;
 	if (orientation == 0) {
 		new_x--;
 	}
@@ -82,95 +485,124 @@ std::pair<int, int> Snake::determineNewCords() {
 	return std::pair<int, int>(new_x, new_y);
 }
 
-void Snake::getLastSegmentCords(int& x, int& y) {
-	if (len > 2) {
-		x = segments.back().x;
-		y = segments.back().y;
-	}
-	else {
-		x = head_cords.first;
-		y = head_cords.second;
-	}
+std::pair<int, int> Snake::determineNewCords() {
+	return step(getHead(), orientation);
 }
 
-void Snake::drawCandy() {
-	paint->drawCandy(candy.first, candy.second, D2D1::ColorF(candy_r, candy_g, candy_b));
+bool Snake::isFree(const std::pair<int, int>& p) const {
+	return !occupancy.isOccupied(p.first, p.second);
 }
 
-void Snake::randomizeCandy() {
-	std::mt19937 rng(static_cast<unsigned int>(std::time(nullptr)));
-	std::uniform_real_distribution<float> distrib_f(0.0f, 1.0f);
-	std::uniform_int_distribution<int> distrib_i(0, (int) freeSpots.size() - 1);
+std::pair<int, int> Snake::getHead() const {
+	const Body::Cell& head = body.front();
+	return std::pair<int, int>(head.x, head.y);
+}
 
-	candy_r = distrib_f(rng);
-	candy_g = distrib_f(rng);
-	candy_b = distrib_f(rng);
+BoardSize Snake::getBoardSize() const {
+	return BoardSize{ width, height };
+}
 
-	int pos = distrib_i(rng);
-	int i = 0;
-	for (auto it : freeSpots) {
-		i++;
-		if (i == pos) {
-			candy.first = it.first;
-			candy.second = it.second;
-			return;
-		}
+const Body& Snake::getBody() const {
+	return body;
+}
+
+template <int W, int H>
+void Snake::occupy(int x, int y) {
+	occupancy.occupy<W>(x, y);
+	free_cells.remove(x * (W ? W : width) + y);
+}
+
+template <int W, int H>
+void Snake::release(int x, int y) {
+	occupancy.release<W>(x, y);
+	free_cells.add(x * (W ? W : width) + y);
+}
+
+template <int W, int H>
+void Snake::randomizeCandy() {
+	PROFILE_SCOPE(PHASE_CANDY);
+	float r = rng.nextFloat();
+	float g = rng.nextFloat();
+	float b = rng.nextFloat();
+	candy_color = paletteIndex(Color{ r, g, b });
+
+	if (free_cells.size() == 0) {
+		candy = std::pair<int, int>(-1, -1);
+		return;
 	}
+	int cell = free_cells.at(rng.below(free_cells.size()));
+	candy.first = cell / (W ? W : width);
+	candy.second = cell % (W ? W : width);
+	changes.mark(candy.first, candy.second);
 }
 
-void Snake::eatCandy(int prev, int last_x, int last_y) {
+template <int W, int H>
+void Snake::eatCandy() {
 	eating_animation = true;
-	eating_animation_r = candy_r;
-	eating_animation_g = candy_g;
-	eating_animation_b = candy_b;
-
-	segments.push_back(Segment(
-		prev,
-		(tail_orientation + 2) % 4,
-		last_x, last_y,
-		candy_r, candy_g, candy_b));
+	eating_animation_color = candy_color;
+
 	len++;
-	randomizeCandy();
+	if (len == (W ? W * H : width * height)) {
+		running = false; // nothing left to eat, the game is won
+		game_end = GameEnd::WON;
+	}
+	randomizeCandy<W, H>();
 }
 
-HRESULT Snake::drawEatingAnimation() {
-	return paint->drawEatingAnimation(
-		head_cords.first,
-		head_cords.second,
-		orientation,
-		D2D1::ColorF(eating_animation_r, eating_animation_g, eating_animation_b));
+void Snake::placeCandy() {
+	if (candy.first >= 0) {
+		changes.mark(candy.first, candy.second); // to paint the old cell over
+	}
+	randomizeCandy<0, 0>();
 }
 
 void Snake::moveOneStep() {
+	PROFILE_SCOPE(PHASE_TICK);
+	(this->*step_function)();
+}
+
+template <int W, int H>
+void Snake::moveOneStepOn() {
 	eating_animation = false;
 	orientation = new_orientation;
 	std::pair<int, int> new_head_cords = determineNewCords();
 	bool lengthen = (candy.first == new_head_cords.first && candy.second == new_head_cords.second);
+	// the old head turns into the neck (or at least faces elsewhere)
+	changes.mark(body.front().x, body.front().y);
+	const Body::Cell& tail = body.back();
 	if (!lengthen) {
-		freeSpots.insert(tail_cords);
+		release<W, H>(tail.x, tail.y);
 	}
 
-	auto it = freeSpots.find(new_head_cords);
-	if (checkIfOutOfBounds(new_head_cords) || freeSpots.end() == it) {
+	// the border around the board is taken too, so this also catches walls
+	if (occupancy.isOccupied<W>(new_head_cords.first, new_head_cords.second)) {
 		running = false;
+		bool outside = new_head_cords.first < 0 || new_head_cords.first >= (H ? H : height) ||
+			new_head_cords.second < 0 || new_head_cords.second >= (W ? W : width);
+		game_end = outside ? GameEnd::WALL : GameEnd::SELF;
 	}
 	else {
-		int last_segment_x, last_segment_y;
-		getLastSegmentCords(last_segment_x, last_segment_y);
-		head_cords.first = new_head_cords.first;
-		head_cords.second = new_head_cords.second;
-		freeSpots.erase(it);
-		int prev_element = orientation; // tells each segment where the previous one went
-		for (Segment& seg : segments) {
-			prev_element = seg.move(prev_element);
+		occupy<W, H>(new_head_cords.first, new_head_cords.second);
+		// Cells keep their color while the snake slides over them: the
+		// color of the segment that becomes the tail moves to the neck,
+		// an eaten candy adds its own color there instead
+		uint8_t neck_color = candy_color;
+		if (!lengthen) {
+			changes.mark(tail.x, tail.y);
+			if (body.size() > 2) {
+				neck_color = body.segmentColor(body.size() - 2);
+			}
+			body.popTail();
 		}
-		if (lengthen) {
-			eatCandy(prev_element, last_segment_x, last_segment_y);
+		pushHead(new_head_cords.first, new_head_cords.second);
+		if (body.size() > 2) {
+			body.setSegmentColor(1, neck_color);
 		}
-		else {
-			tail_orientation = prev_element;
-			tail_cords = std::pair<int, int>(last_segment_x, last_segment_y);
+		changes.mark(new_head_cords.first, new_head_cords.second);
+		changes.mark(body.back().x, body.back().y);
+		if (lengthen) {
+			eatCandy<W, H>();
 		}
 	}
 	orientation_changed = false;
-}
\ No newline at end of file
+}
@@ -1,56 +1,141 @@
 #ifndef SNAKE_H
 #define SNAKE_H
 
-#include <list>
-#include <unordered_set>
 #include <utility>
-#include <random>
-#include <ctime>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <memory_resource>
 
-#include "Paint.h"
+#include "Config.h"
+#include "Arena.h"
+#include "RenderSink.h"
 #include "Segment.h"
+#include "CommandBuffer.h"
+#include "ChangeSet.h"
+#include "Body.h"
+#include "Grid.h"
+#include "FreeCells.h"
+#include "Rng.h"
+
+// What a player (or an agent) can do during one tick
+enum class Action {
+	STRAIGHT = 0,
+	LEFT = 1,
+	RIGHT = 2
+};
+
+// Why a game stopped; TIMEOUT is only ever set by whoever runs the game
+enum class GameEnd {
+	NONE = 0,
+	WALL = 1,
+	SELF = 2,
+	WON = 3,
+	TIMEOUT = 4
+};
+
+/************************************************************************
+*	The whole state of a game in one flat block of bytes, taken by		*
+*	Snake::snapshot and put back by Snake::restore. Both are a few		*
+*	memcpy calls over buffers that are already there: the fields of		*
+*	the game, the cells the snake lies on, the occupancy bits and the	*
+*	free cells as FreeCells keeps them. Nothing in it points anywhere,	*
+*	so a snapshot can be copied around and restored into any game on	*
+*	the same board.														*
+************************************************************************/
+class SnakeSnapshot {
+private:
+	friend class Snake;
+
+	std::vector<std::byte> bytes; // as many as the board can need
+	std::size_t used;
+
+public:
+	explicit SnakeSnapshot(BoardSize size);
+
+	SnakeSnapshot(const SnakeSnapshot& other) = default;
+
+	// Copies only the bytes in use; both must be for the same board
+	SnakeSnapshot& operator=(const SnakeSnapshot& other);
+
+	inline std::size_t size() const {
+		return used;
+	}
+};
 
 class Snake {
 private:
-	// Hash function for pairs of integers
-	struct PairHash {
-		inline size_t operator()(const std::pair<int, int>& p) const {
-			// Combine hashes of the two integers using bitwise operations
-			return (size_t)p.first * 809 + (size_t)p.second;
-		}
-	};
+	friend class SnakeSnapshot;
 
-	Paint* paint;
-	/************************************************************************
-	*					0 : Snake going up the screen						*
-	*					1 : Snake going right								*
-	*					2 : Snake going down								*
-	*					3 : Snake going left								*
-	************************************************************************/
-	int tail_orientation;
+	// moveOneStep for one board size, see selectStep
+	typedef void (Snake::*StepFunction)();
 
-	std::pair<int, int> head_cords;
-	std::pair<int, int> tail_cords;
+	RenderSink* sink;
+	int width;
+	int height;
+	StepFunction step_function;
+	uint8_t candy_color; // palette indices
+	uint8_t eating_animation_color;
 
-	float candy_r;
-	float candy_g;
-	float candy_b;
-	float eating_animation_r;
-	float eating_animation_g;
-	float eating_animation_b;
+	// holds everything below that grows with the board, so once a game
+	// is created neither ticks nor frames touch the heap
+	Arena arena;
+	Body body;
+	Grid occupancy;
+	FreeCells free_cells; // the same free cells, indexed for O(1) candy placement
 
-	std::list<Segment> segments;
-	std::unordered_set<std::pair<int, int>, PairHash> freeSpots;
+	Rng rng; // created once, restart() keeps drawing from the same stream
+
+	CommandBuffer commands; // what draw() hands to the sink, reused every frame
+	ChangeSet changes; // cells to repaint in the next frame
+	std::pmr::vector<unsigned int> body_slot; // ring slot of the snake part on each cell
+	std::pmr::vector<int> nearby; // scratch for draw(): body indices next to changes
+
+	// The fields of the game itself, as a snapshot keeps them
+	struct Fields {
+		bool running;
+		GameEnd game_end;
+		int len;
+		int orientation;
+		int new_orientation;
+		bool orientation_changed;
+		bool eating_animation;
+		int candy_x;
+		int candy_y;
+		uint8_t candy_color;
+		uint8_t eating_animation_color;
+		Rng rng;
+	};
+
+	// W and H are the board size when known at compile time, 0 if not
+	template <int W, int H> void occupy(int x, int y);
+	template <int W, int H> void release(int x, int y);
+	template <int W, int H> void randomizeCandy();
+	template <int W, int H> void eatCandy();
+	template <int W, int H> void moveOneStepOn();
+	static StepFunction selectStep(BoardSize size);
 
 	std::pair<int, int> determineNewCords();
-	void getLastSegmentCords(int& x, int& y);
-	void randomizeCandy();
-	void drawCandy();
-	HRESULT drawEatingAnimation();
+	void updateSlots();
+	void pushHead(int x, int y);
+	bool isStraight(int i) const;
+	void recordSegment(int i);
+	void recordRun(int first, int last);
+	void recordEnds(bool head, bool tail, bool candy_visible);
+	void recordAll();
+	void recordNear();
 
 public:
 	bool running;
+	GameEnd game_end;
 	int len;
+	/************************************************************************
+	*					0 : Snake going up the screen						*
+	*					1 : Snake going right								*
+	*					2 : Snake going down								*
+	*					3 : Snake going left								*
+	************************************************************************/
 	int orientation;
 	int new_orientation;
 	bool orientation_changed;
@@ -58,16 +143,59 @@ public:
 
 	std::pair<int, int> candy;
 
+	// sink may be nullptr for headless games, which then get no buffers
+	// for drawing; the same seed and stream always give the same candy
+	// sequence
+	Snake(RenderSink* s, BoardSize size, uint64_t seed, uint64_t stream = 0);
+	// Copies are made in an arena of their own and draw to the same sink
+	Snake(const Snake& other);
+	// Copies the game into the storage that is already there, so both
+	// games must be on the same board; the sink and what it was last
+	// drawn stay this game's own, the next draw() repaints everything
+	Snake& operator=(const Snake& other);
+	// A headless copy: just the game, without the buffers for drawing
+	std::unique_ptr<Snake> fork() const;
+	// Bytes of the arena of a game on the board, with or without the
+	// buffers for drawing
+	static std::size_t arenaSize(BoardSize size, bool drawn = true);
+	// Draws the cells that changed since the last call, or everything if
+	// the sink doesn't keep its last frame
+	int draw();
+	// The next draw() repaints the whole board
+	void invalidate();
+	const ChangeSet& getChanges() const;
+	void turn(Action action);
+	void moveOneStep();
+	// Puts the candy on another random free cell, the way eating does
+	void placeCandy();
+	// p must lie on the board or right next to it
+	bool isFree(const std::pair<int, int>& p) const;
+	std::pair<int, int> getHead() const;
+	BoardSize getBoardSize() const;
+	// Cells the snake lies on, from the head (0) to the tail
+	const Body& getBody() const;
 
-	// when was the last time the snake was drawn
-	long long last_time;
-
+	// Cell next to p in the given orientation
+	static std::pair<int, int> step(const std::pair<int, int>& p, int orientation);
 
-	Snake(Paint * p);
-	HRESULT draw();
-	void moveOneStep();
+	// Starts a new game without allocating; takes about the same time
+	// for any board size
 	void restart();
-	void eatCandy(int prev, int last_x, int last_y);
+	// Same, but continues with a fresh (seed, stream)
+	void restart(uint64_t seed, uint64_t stream);
+
+	// Keeps the state of the game in snapshot, which must be for this
+	// board; doesn't allocate
+	void snapshot(SnakeSnapshot& snapshot) const;
+	// Puts back a snapshot of a game on this board; the next draw()
+	// repaints everything
+	void restore(const SnakeSnapshot& snapshot);
+	// Appends the whole state of the game to bytes; loadState() on a
+	// game on the same board carries on exactly from there
+	void saveState(std::vector<uint8_t>& bytes) const;
+	// 1 if the bytes are not a state saved on this board; the game has
+	// to be restarted then
+	int loadState(const uint8_t* bytes, std::size_t size);
 };
 
 #endif
\ No newline at end of file
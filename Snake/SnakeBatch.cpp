@@ -0,0 +1,184 @@
+#include "SnakeBatch.h"
+
+#include <bit>
+#include <algorithm>
+
+// Draws after which placeCandy stops guessing and counts free cells
+static const int CANDY_TRIES = 16;
+
+SnakeBatch::SnakeBatch(int games, BoardSize size, uint64_t seed, int max_ticks) {
+	count = games;
+	width = size.width;
+	height = size.height;
+	stride = width + 2;
+	padded_cells = (height + 2) * stride;
+	plane_words = (padded_cells + 63) / 64;
+	this->max_ticks = max_ticks;
+
+	uint32_t capacity = 1;
+	while (capacity < (uint32_t) (width * height)) {
+		capacity <<= 1;
+	}
+	ring_mask = capacity - 1;
+
+	// border and the bits past the last row are taken
+	empty_plane.assign(plane_words, ~(uint64_t) 0);
+	for (int x = 0; x < height; x++) {
+		for (int y = 0; y < width; y++) {
+			int i = index(x, y);
+			empty_plane[i >> 6] &= ~((uint64_t) 1 << (i & 63));
+		}
+	}
+
+	head.resize(count);
+	tail.resize(count);
+	orientation.resize(count);
+	length.resize(count);
+	candy.resize(count);
+	ticks.resize(count);
+	ring_head.resize(count);
+	next_head.resize(count);
+	eats.resize(count);
+	hits.resize(count);
+	planes.resize((std::size_t) count * plane_words);
+	rings.resize((std::size_t) count * capacity);
+	rewards.assign(count, 0.0f);
+	dones.assign(count, 0);
+	last_length.assign(count, 0);
+	last_ticks.assign(count, 0);
+	last_end.assign(count, GameEnd::NONE);
+
+	rngs.reserve(count);
+	for (int game = 0; game < count; game++) {
+		rngs.emplace_back(seed, (uint64_t) game);
+		resetGame(game);
+	}
+}
+
+void SnakeBatch::resetGame(int game) {
+	uint64_t* plane = planeOf(game);
+	std::copy(empty_plane.begin(), empty_plane.end(), plane);
+
+	int32_t* ring = ringOf(game);
+	ring[0] = index(0, 0);
+	ring[1] = index(0, 1);
+	ring_head[game] = 1;
+	tail[game] = ring[0];
+	head[game] = ring[1];
+	plane[ring[0] >> 6] |= (uint64_t) 1 << (ring[0] & 63);
+	plane[ring[1] >> 6] |= (uint64_t) 1 << (ring[1] & 63);
+
+	orientation[game] = 1;
+	length[game] = 2;
+	ticks[game] = 0;
+	placeCandy(game);
+}
+
+void SnakeBatch::placeCandy(int game) {
+	int free = width * height - length[game];
+	if (free == 0) {
+		candy[game] = -1;
+		return;
+	}
+	Rng& rng = rngs[game];
+
+	// Guessing hits a free cell quickly unless the board is nearly full;
+	// an accepted guess is uniform over the free cells either way
+	for (int tries = 0; tries < CANDY_TRIES; tries++) {
+		int cell = (int) rng.below((uint32_t) padded_cells);
+		if (isFree(game, cell)) {
+			candy[game] = cell;
+			return;
+		}
+	}
+
+	int k = (int) rng.below((uint32_t) free);
+	const uint64_t* plane = planeOf(game);
+	for (int w = 0; w < plane_words; w++) {
+		uint64_t free_bits = ~plane[w];
+		int bits = std::popcount(free_bits);
+		if (k >= bits) {
+			k -= bits;
+			continue;
+		}
+		for (; k > 0; k--) {
+			free_bits &= free_bits - 1;
+		}
+		candy[game] = w * 64 + std::countr_zero(free_bits);
+		return;
+	}
+}
+
+void SnakeBatch::step(const Action* actions) {
+	// Pass 1: new orientation, new head and whether it eats. No branches
+	// and no indirection, so the compiler can vectorize it.
+	for (int i = 0; i < count; i++) {
+		int action = (int) actions[i];
+		int o = (orientation[i] + (action == (int) Action::RIGHT) + 3 * (action == (int) Action::LEFT)) & 3;
+		orientation[i] = o;
+		int n = head[i] + (o == 1) - (o == 3) + stride * ((o == 2) - (o == 0));
+		next_head[i] = n;
+		eats[i] = n == candy[i];
+	}
+
+	// Pass 2: collision test, one bit per game. Stepping onto the tail is
+	// fine unless the snake grows and the tail stays put.
+	for (int i = 0; i < count; i++) {
+		int n = next_head[i];
+		int taken = (int) ((planeOf(i)[n >> 6] >> (n & 63)) & 1);
+		hits[i] = taken & !(n == tail[i] && !eats[i]);
+	}
+
+	// Pass 3: move the bodies, O(1) per game
+	for (int i = 0; i < count; i++) {
+		rewards[i] = 0.0f;
+		dones[i] = 0;
+		ticks[i]++;
+		bool finished = false;
+		GameEnd end = GameEnd::TIMEOUT;
+
+		if (hits[i]) {
+			rewards[i] = -1.0f;
+			finished = true;
+			// only the border around the board is taken outside it
+			int x = next_head[i] / stride - 1;
+			int y = next_head[i] % stride - 1;
+			bool outside = x < 0 || x >= height || y < 0 || y >= width;
+			end = outside ? GameEnd::WALL : GameEnd::SELF;
+		}
+		else {
+			uint64_t* plane = planeOf(i);
+			int32_t* ring = ringOf(i);
+			int n = next_head[i];
+			if (eats[i]) {
+				rewards[i] = 1.0f;
+			}
+			else {
+				int t = tail[i];
+				plane[t >> 6] &= ~((uint64_t) 1 << (t & 63));
+				tail[i] = ring[(ring_head[i] - (uint32_t) length[i] + 2) & ring_mask];
+			}
+			plane[n >> 6] |= (uint64_t) 1 << (n & 63);
+			ring_head[i] = (ring_head[i] + 1) & ring_mask;
+			ring[ring_head[i]] = n;
+			head[i] = n;
+			if (eats[i]) {
+				length[i]++;
+				placeCandy(i);
+				if (candy[i] < 0) {
+					// the board is full
+					finished = true;
+					end = GameEnd::WON;
+				}
+			}
+		}
+
+		if (finished || (max_ticks > 0 && ticks[i] >= max_ticks)) {
+			dones[i] = 1;
+			last_length[i] = length[i];
+			last_ticks[i] = ticks[i];
+			last_end[i] = end;
+			resetGame(i);
+		}
+	}
+}
@@ -0,0 +1,146 @@
+#ifndef SNAKE_BATCH_H
+#define SNAKE_BATCH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Config.h"
+#include "Snake.h"
+#include "Rng.h"
+
+/************************************************************************
+*	Many headless games on the same board, kept as structure of arrays.	*
+*	Cells are addressed by their bit index in a bordered occupancy		*
+*	plane (see Grid), so a move is one add and walls need no check.		*
+*	step() advances every game by one tick: first a branch-free pass	*
+*	over all games computes the new heads, then a short scalar pass		*
+*	applies the moves. Finished games are restarted on the spot and		*
+*	their result is kept in the last* arrays until they end again.		*
+************************************************************************/
+class SnakeBatch {
+private:
+	int count;
+	int width;
+	int height;
+	int stride;
+	int plane_words;
+	int padded_cells;
+	int max_ticks;
+	uint32_t ring_mask;
+
+	std::vector<uint64_t> empty_plane;
+
+	// one entry per game
+	std::vector<int32_t> head;
+	std::vector<int32_t> tail;
+	std::vector<int32_t> orientation;
+	std::vector<int32_t> length;
+	std::vector<int32_t> candy;
+	std::vector<int32_t> ticks;
+	std::vector<uint32_t> ring_head;
+	std::vector<Rng> rngs;
+
+	// scratch written by the vector pass
+	std::vector<int32_t> next_head;
+	std::vector<uint8_t> eats;
+	std::vector<uint8_t> hits;
+
+	// count * plane_words and count * (ring_mask + 1) entries
+	std::vector<uint64_t> planes;
+	std::vector<int32_t> rings;
+
+	// outputs of the last step
+	std::vector<float> rewards;
+	std::vector<uint8_t> dones;
+	std::vector<int32_t> last_length;
+	std::vector<int32_t> last_ticks;
+	std::vector<GameEnd> last_end;
+
+	inline uint64_t* planeOf(int game) {
+		return &planes[(std::size_t) game * plane_words];
+	}
+
+	inline const uint64_t* planeOf(int game) const {
+		return &planes[(std::size_t) game * plane_words];
+	}
+
+	inline int32_t* ringOf(int game) {
+		return &rings[(std::size_t) game * (ring_mask + 1)];
+	}
+
+	void resetGame(int game);
+	void placeCandy(int game);
+
+public:
+	// Game i draws from stream i of seed. max_ticks > 0 ends games that
+	// run longer than that, 0 lets them run until they die.
+	SnakeBatch(int games, BoardSize size, uint64_t seed, int max_ticks = 0);
+
+	// actions holds one entry per game
+	void step(const Action* actions);
+
+	inline int size() const {
+		return count;
+	}
+
+	inline BoardSize getBoardSize() const {
+		return BoardSize{ width, height };
+	}
+
+	// Cell helpers for policies; x may be -1..height and y -1..width
+	inline int index(int x, int y) const {
+		return (x + 1) * stride + (y + 1);
+	}
+
+	inline bool isFree(int game, int cell) const {
+		return !((planeOf(game)[cell >> 6] >> (cell & 63)) & 1);
+	}
+
+	// Cell next to the given one in orientation 0..3
+	inline int neighbour(int cell, int orient) const {
+		return cell + (orient == 1) - (orient == 3) + stride * ((orient == 2) - (orient == 0));
+	}
+
+	inline int headOf(int game) const {
+		return head[game];
+	}
+
+	inline int orientationOf(int game) const {
+		return orientation[game];
+	}
+
+	inline int candyOf(int game) const {
+		return candy[game];
+	}
+
+	inline int lengthOf(int game) const {
+		return length[game];
+	}
+
+	// +1 for eating, -1 for dying, 0 otherwise
+	inline const float* getRewards() const {
+		return rewards.data();
+	}
+
+	// 1 where the game ended during the last step and was restarted
+	inline const uint8_t* getDones() const {
+		return dones.data();
+	}
+
+	// Length and ticks of the last finished game in each slot
+	inline const int32_t* getLastLengths() const {
+		return last_length.data();
+	}
+
+	inline const int32_t* getLastTicks() const {
+		return last_ticks.data();
+	}
+
+	// How it ended, TIMEOUT when max_ticks cut it short
+	inline const GameEnd* getLastEnds() const {
+		return last_end.data();
+	}
+};
+
+#endif
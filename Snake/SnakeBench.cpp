@@ -0,0 +1,601 @@
+// Microbenchmarks of the engine and the software renderer.
+//
+//   snake-bench [--bench B[,B...]] [--board WxH[,WxH...]] [--length L[,L...]]
+//               [--time MS] [--save PATH] [--baseline PATH] [--threshold PCT]
+//
+// Every benchmark runs on every board with a snake of every length and
+// prints the time and the number of heap allocations per operation:
+//
+//   move       one Snake::moveOneStep (the turn before it included)
+//   candy      one Snake::placeCandy
+//   restart    one Snake::restart, always from a snake of the given length
+//   collision  one Snake::isFree next to the head
+//   snapshot   one Snake::snapshot
+//   restore    one Snake::restore of that snapshot
+//   copy       one Snake::operator= from another game
+//   fork       one Snake::fork, a headless copy in an arena of its own
+//   autopilot  one AutopilotAgent::decide and the move it picks
+//   draw-null  one Snake::draw into a sink that throws the frame away
+//   draw-soft  one frame of Snake::draw into SoftPaint
+//
+// The snake follows a fixed cycle over the whole board, so it never dies
+// and only grows; once it is a quarter longer than asked for it is put
+// back to the state it was measured from. Each case runs for about MS
+// milliseconds split into a few rounds, and the fastest round counts.
+// --save writes the results to PATH, --baseline compares them with an
+// earlier file and exits with 1 if a case got more than PCT percent
+// slower or allocates more than it used to.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "Snake.h"
+#include "Autopilot.h"
+#include "SoftPaint.h"
+#include "AllocationCounter.h"
+
+static const int ROUNDS = 5;
+// a snake this much longer than asked for is put back
+static const int SLACK_DIVISOR = 4;
+
+struct BenchOptions {
+	std::vector<std::string> benches = { "move", "candy", "restart", "collision", "snapshot", "restore", "copy",
+		"fork", "autopilot", "draw-null", "draw-soft" };
+	std::vector<BoardSize> boards = { { 10, 10 }, { 20, 20 }, DEFAULT_BOARD, { 64, 64 }, { 30, 16 } };
+	std::vector<int> lengths = { 4, 64, 512 };
+	int time_ms = 200;
+	std::string save_path;
+	std::string baseline_path;
+	double threshold = 10.0;
+};
+
+// Time and allocations of the parts of a round that are measured
+class Stopwatch {
+private:
+	std::chrono::steady_clock::time_point start_time;
+	long long start_allocations = 0;
+
+public:
+	std::chrono::steady_clock::duration elapsed{ 0 };
+	long long allocated = 0;
+
+	inline void start() {
+		start_allocations = allocationCount();
+		start_time = std::chrono::steady_clock::now();
+	}
+
+	inline void stop() {
+		elapsed += std::chrono::steady_clock::now() - start_time;
+		allocated += allocationCount() - start_allocations;
+	}
+
+	inline double nanoseconds() const {
+		return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	}
+};
+
+struct BenchResult {
+	std::string name;
+	BoardSize board;
+	int length;
+	double ns_per_op;
+	double allocations_per_op;
+};
+
+// Draws nothing, so draw() is timed on its own
+class NullSink : public RenderSink {
+public:
+	int drawStraightSegment(int, int, int, Color) override {
+		return 0;
+	}
+
+	int drawCurvedSegment(int, int, int, Color) override {
+		return 0;
+	}
+
+	int drawHead(int, int, int) override {
+		return 0;
+	}
+
+	int drawTail(int, int, int) override {
+		return 0;
+	}
+
+	int drawCandy(int, int, Color) override {
+		return 0;
+	}
+
+	int drawEatingAnimation(int, int, int, Color) override {
+		return 0;
+	}
+
+	int drawCommands(CommandBuffer&) override {
+		return 0;
+	}
+
+	bool keepsLastFrame() const override {
+		return true;
+	}
+};
+
+/************************************************************************
+*	Steers a snake around a cycle through every cell: right along the	*
+*	top row, then back and forth over the other columns down to the		*
+*	bottom, and up the first column to where it started. That is where	*
+*	a new game starts too, so the snake is on the cycle from the first	*
+*	tick. It needs an even number of rows to close.						*
+************************************************************************/
+class CycleSteering {
+private:
+	int width;
+	std::vector<uint8_t> orientations; // where to go from each cell
+
+public:
+	CycleSteering(BoardSize board) : width(board.width), orientations((size_t) board.width * board.height) {
+		for (int x = 0; x < board.height; x++) {
+			for (int y = 0; y < board.width; y++) {
+				int orientation;
+				if (y == 0) {
+					orientation = x == 0 ? 1 : 0;
+				}
+				else if (x % 2 == 0) {
+					orientation = y < board.width - 1 ? 1 : 2;
+				}
+				else if (y > 1) {
+					orientation = 3;
+				}
+				else {
+					orientation = x == board.height - 1 ? 3 : 2;
+				}
+				orientations[(size_t) x * board.width + y] = (uint8_t) orientation;
+			}
+		}
+	}
+
+	inline Action decide(const Snake& snake) const {
+		std::pair<int, int> head = snake.getHead();
+		int target = orientations[(size_t) head.first * width + head.second];
+		if (target == snake.orientation) {
+			return Action::STRAIGHT;
+		}
+		return target == (snake.orientation + 1) % 4 ? Action::RIGHT : Action::LEFT;
+	}
+
+	inline void tick(Snake& snake) const {
+		snake.turn(decide(snake));
+		snake.moveOneStep();
+	}
+
+	// Plays a new game until the snake is length cells long
+	void grow(Snake& snake, int length) const {
+		snake.restart();
+		while (snake.len < length && snake.running) {
+			tick(snake);
+		}
+	}
+};
+
+// One case: work on a snake of the given length, measured by the bench
+struct BenchCase {
+	BoardSize board;
+	int length;
+	const CycleSteering& steering;
+	Snake& snake;
+	const Snake& start; // snake is put back to this one when it grows too long
+
+	// Whether the snake had to be put back
+	inline bool keepLength() {
+		if (snake.len > length + length / SLACK_DIVISOR + 1 || !snake.running) {
+			snake = start;
+			snake.invalidate();
+			return true;
+		}
+		return false;
+	}
+};
+
+// Runs ops operations of a benchmark, timing only what the stopwatch sees
+typedef std::function<void(BenchCase&, long long, Stopwatch&)> BenchFunction;
+
+static void benchMove(BenchCase& bench, long long ops, Stopwatch& watch) {
+	while (ops > 0) {
+		long long chunk = std::min<long long>(ops, 64);
+		watch.start();
+		for (long long i = 0; i < chunk; i++) {
+			bench.steering.tick(bench.snake);
+		}
+		watch.stop();
+		ops -= chunk;
+		bench.keepLength();
+	}
+}
+
+static void benchCandy(BenchCase& bench, long long ops, Stopwatch& watch) {
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		bench.snake.placeCandy();
+	}
+	watch.stop();
+}
+
+static void benchRestart(BenchCase& bench, long long ops, Stopwatch& watch) {
+	for (long long i = 0; i < ops; i++) {
+		bench.snake = bench.start;
+		watch.start();
+		bench.snake.restart();
+		watch.stop();
+	}
+}
+
+// keeps the collision checks from being optimized away
+static volatile int collision_result;
+
+static void benchCollision(BenchCase& bench, long long ops, Stopwatch& watch) {
+	std::pair<int, int> head = bench.snake.getHead();
+	int free = 0;
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		free += bench.snake.isFree(Snake::step(head, (int) (i & 3)));
+	}
+	watch.stop();
+	collision_result = free;
+}
+
+static void benchSnapshot(BenchCase& bench, long long ops, Stopwatch& watch) {
+	SnakeSnapshot snapshot(bench.board);
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		bench.snake.snapshot(snapshot);
+	}
+	watch.stop();
+}
+
+static void benchRestore(BenchCase& bench, long long ops, Stopwatch& watch) {
+	SnakeSnapshot snapshot(bench.board);
+	bench.start.snapshot(snapshot);
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		bench.snake.restore(snapshot);
+	}
+	watch.stop();
+}
+
+static void benchCopy(BenchCase& bench, long long ops, Stopwatch& watch) {
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		bench.snake = bench.start;
+	}
+	watch.stop();
+}
+
+static void benchFork(BenchCase& bench, long long ops, Stopwatch& watch) {
+	watch.start();
+	for (long long i = 0; i < ops; i++) {
+		std::unique_ptr<Snake> fork = bench.snake.fork();
+	}
+	watch.stop();
+}
+
+// The agent plans again whenever the snake has been put back
+static void benchAutopilot(BenchCase& bench, long long ops, Stopwatch& watch) {
+	AutopilotAgent agent;
+	agent.reset(bench.snake.getBoardSize(), 0, 0);
+	while (ops > 0) {
+		long long chunk = std::min<long long>(ops, 64);
+		long long done = 0;
+		watch.start();
+		for (; done < chunk && bench.snake.running; done++) {
+			bench.snake.turn(agent.decide(bench.snake));
+			bench.snake.moveOneStep();
+		}
+		watch.stop();
+		ops -= done;
+		bench.keepLength();
+	}
+}
+
+// A tick outside the clock, then the frame that shows it
+static void benchDraw(BenchCase& bench, long long ops, Stopwatch& watch, SoftPaint* paint) {
+	for (long long i = 0; i < ops; i++) {
+		bench.steering.tick(bench.snake);
+		if (bench.keepLength()) {
+			bench.snake.draw(); // the whole board, not what is timed
+		}
+		watch.start();
+		if (paint) {
+			paint->beginDraw();
+		}
+		bench.snake.draw();
+		if (paint) {
+			paint->endDraw();
+		}
+		watch.stop();
+	}
+}
+
+// Finds how many operations fill a round, then keeps the fastest of a
+// few rounds after a warm-up one; allocations are averaged over them
+static BenchResult measure(const std::string& name, BenchCase& bench, const BenchFunction& run, int time_ms) {
+	double round_ns = time_ms * 1e6 / ROUNDS;
+	long long ops = 1;
+	for (;;) {
+		Stopwatch watch;
+		run(bench, ops, watch);
+		double ns = watch.nanoseconds();
+		if (ns >= round_ns / 4 || ops >= (1LL << 32)) {
+			ops = std::max(1LL, (long long) (ops * (round_ns / std::max(ns, 1.0))));
+			break;
+		}
+		ops *= ns > 0 ? std::clamp((long long) (round_ns / ns), 2LL, 100LL) : 100;
+	}
+
+	// buffers that only grow get to their size before anything counts
+	Stopwatch warm_up;
+	run(bench, ops, warm_up);
+
+	double best = 0;
+	long long allocated = 0;
+	for (int round = 0; round < ROUNDS; round++) {
+		Stopwatch watch;
+		run(bench, ops, watch);
+		double ns = watch.nanoseconds() / ops;
+		if (round == 0 || ns < best) {
+			best = ns;
+		}
+		allocated += watch.allocated;
+	}
+	return BenchResult{ name, bench.board, bench.length, best, (double) allocated / ((double) ops * ROUNDS) };
+}
+
+static std::vector<BenchResult> runBenches(const BenchOptions& options) {
+	std::vector<BenchResult> results;
+	for (const BoardSize& board : options.boards) {
+		CycleSteering steering(board);
+		NullSink null_sink;
+		SoftPaint paint(board);
+		for (int length : options.lengths) {
+			// the snake has to fit with room to spare
+			if (length > board.width * board.height * 3 / 4) {
+				continue;
+			}
+			for (const std::string& name : options.benches) {
+				RenderSink* sink = name == "draw-null" ? (RenderSink*) &null_sink : name == "draw-soft" ? &paint : nullptr;
+				Snake start(sink, board, 1);
+				steering.grow(start, length);
+				Snake snake = start;
+				BenchCase bench{ board, length, steering, snake, start };
+
+				BenchFunction run;
+				if (name == "move") {
+					run = benchMove;
+				}
+				else if (name == "candy") {
+					run = benchCandy;
+				}
+				else if (name == "restart") {
+					run = benchRestart;
+				}
+				else if (name == "collision") {
+					run = benchCollision;
+				}
+				else if (name == "snapshot") {
+					run = benchSnapshot;
+				}
+				else if (name == "restore") {
+					run = benchRestore;
+				}
+				else if (name == "copy") {
+					run = benchCopy;
+				}
+				else if (name == "fork") {
+					run = benchFork;
+				}
+				else if (name == "autopilot") {
+					run = benchAutopilot;
+				}
+				else {
+					SoftPaint* target = sink == &paint ? &paint : nullptr;
+					run = [target](BenchCase& c, long long ops, Stopwatch& watch) {
+						benchDraw(c, ops, watch, target);
+					};
+					// the first frame paints everything
+					snake.draw();
+				}
+				results.push_back(measure(name, bench, run, options.time_ms));
+			}
+		}
+	}
+	return results;
+}
+
+static std::string caseKey(const std::string& name, BoardSize board, int length) {
+	return name + " " + std::to_string(board.width) + "x" + std::to_string(board.height) + " " + std::to_string(length);
+}
+
+// One line per case: name, board, length, ns/op, allocations/op
+static int saveResults(const std::vector<BenchResult>& results, const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		return 1;
+	}
+	for (const BenchResult& result : results) {
+		file << caseKey(result.name, result.board, result.length) << " "
+			<< std::fixed << std::setprecision(3) << result.ns_per_op << " " << result.allocations_per_op << "\n";
+	}
+	return file.good() ? 0 : 1;
+}
+
+static int loadBaseline(const std::string& path, std::map<std::string, BenchResult>& baseline) {
+	std::ifstream file(path);
+	if (!file) {
+		return 1;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		std::string name;
+		std::string board_text;
+		BenchResult result;
+		if (!(fields >> name >> board_text >> result.length >> result.ns_per_op >> result.allocations_per_op) ||
+			std::sscanf(board_text.c_str(), "%dx%d", &result.board.width, &result.board.height) != 2) {
+			return 1;
+		}
+		result.name = name;
+		baseline[caseKey(name, result.board, result.length)] = result;
+	}
+	return 0;
+}
+
+static std::vector<std::string> splitList(const std::string& value) {
+	std::vector<std::string> items;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		items.push_back(item);
+	}
+	return items;
+}
+
+static void printUsage() {
+	std::cerr << "usage: snake-bench [--bench B[,B...]] [--board WxH[,WxH...]] [--length L[,L...]]\n"
+		"                   [--time MS] [--save PATH] [--baseline PATH] [--threshold PCT]\n"
+		"benches: move, candy, restart, collision, snapshot, restore, copy, fork,\n"
+		"         autopilot, draw-null, draw-soft\n";
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+	static const std::vector<std::string> known = BenchOptions().benches;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (arg == "--bench") {
+			options.benches = splitList(value);
+			for (const std::string& name : options.benches) {
+				if (std::find(known.begin(), known.end(), name) == known.end()) {
+					return false;
+				}
+			}
+		}
+		else if (arg == "--board") {
+			options.boards.clear();
+			for (const std::string& item : splitList(value)) {
+				BoardSize board;
+				if (std::sscanf(item.c_str(), "%dx%d", &board.width, &board.height) != 2) {
+					return false;
+				}
+				options.boards.push_back(board);
+			}
+		}
+		else if (arg == "--length") {
+			options.lengths.clear();
+			for (const std::string& item : splitList(value)) {
+				options.lengths.push_back(std::atoi(item.c_str()));
+			}
+		}
+		else if (arg == "--time") {
+			options.time_ms = std::atoi(value.c_str());
+		}
+		else if (arg == "--save") {
+			options.save_path = value;
+		}
+		else if (arg == "--baseline") {
+			options.baseline_path = value;
+		}
+		else if (arg == "--threshold") {
+			options.threshold = std::atof(value.c_str());
+		}
+		else {
+			return false;
+		}
+	}
+	for (const BoardSize& board : options.boards) {
+		// the steering cycle only closes over an even number of rows
+		if (board.width < 2 || board.height < 2 || board.height % 2 || board.width > 4096 || board.height > 4096) {
+			return false;
+		}
+	}
+	for (int length : options.lengths) {
+		if (length < 2) {
+			return false;
+		}
+	}
+	return options.time_ms > 0 && options.threshold >= 0 && !options.benches.empty() &&
+		!options.boards.empty() && !options.lengths.empty();
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return 1;
+	}
+
+	std::map<std::string, BenchResult> baseline;
+	bool compare = !options.baseline_path.empty();
+	if (compare && loadBaseline(options.baseline_path, baseline)) {
+		std::cerr << "cannot read " << options.baseline_path << "\n";
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(11) << "bench" << std::setw(8) << "board"
+		<< std::right << std::setw(8) << "length" << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op";
+	if (compare) {
+		std::cout << std::setw(12) << "base ns/op" << std::setw(9) << "change";
+	}
+	std::cout << "\n";
+
+	std::vector<BenchResult> results = runBenches(options);
+	int regressions = 0;
+	for (const BenchResult& result : results) {
+		std::cout << std::left << std::setw(11) << result.name
+			<< std::setw(8) << (std::to_string(result.board.width) + "x" + std::to_string(result.board.height))
+			<< std::right << std::setw(8) << result.length
+			<< std::setw(12) << std::fixed << std::setprecision(1) << result.ns_per_op
+			<< std::setw(12) << std::setprecision(3) << result.allocations_per_op;
+		if (compare) {
+			auto found = baseline.find(caseKey(result.name, result.board, result.length));
+			if (found == baseline.end()) {
+				std::cout << std::setw(12) << "-" << std::setw(9) << "new";
+			}
+			else {
+				const BenchResult& base = found->second;
+				double change = (result.ns_per_op / std::max(base.ns_per_op, 1e-9) - 1) * 100;
+				std::cout << std::setw(12) << std::setprecision(1) << base.ns_per_op
+					<< std::setw(8) << std::showpos << change << std::noshowpos << "%";
+				// a buffer growing now and then is no regression, one more
+				// allocation every hundred operations is
+				if (change > options.threshold || result.allocations_per_op > base.allocations_per_op + 0.01) {
+					std::cout << "  REGRESSION";
+					regressions++;
+				}
+			}
+		}
+		std::cout << "\n";
+	}
+
+	if (!options.save_path.empty() && saveResults(results, options.save_path)) {
+		std::cerr << "cannot write " << options.save_path << "\n";
+		return 1;
+	}
+	if (regressions) {
+		std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << " over "
+			<< options.threshold << "%\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,728 @@
+// Headless runner: plays many games and prints statistics.
+//
+//   snake-sim [--games N] [--agent A[,A...]] [--board WxH[,WxH...]] [--seed S]
+//             [--max-ticks T] [--threads T] [--batch B] [--frame PATH]
+//             [--profile PATH] [--max-allocations N] [--record PATH]
+//             [--cycles DIR] [--mcts-budget MS] [--mcts-threads T]
+//   snake-sim --replay PATH [--threads T] [--archive OUT]
+//   snake-sim --archive PATH [--threads T] [--seek GAME:TICK [--frame PATH]]
+//
+// Every agent plays N games on every board, spread over --threads cores
+// (all of them by default). Game i of each pairing plays stream i of the
+// seed, so agents meet the same candies and results don't depend on how
+// the games were scheduled. With --batch a single agent, random or
+// greedy, plays on a single board B games at a time in a SnakeBatch
+// instead, with --max-ticks at most 2^31 - 1. With --frame the first game
+// of the first agent and board is drawn by SoftPaint every tick, the time
+// per frame is printed and the last frame is saved to PATH as a PPM.
+// With --profile the time spent in each phase is written to PATH, as
+// JSON if it ends with .json and CSV otherwise; this needs a build with
+// SNAKE_PROFILE. With --max-allocations the run fails if a game, or a
+// frame after the first one, allocates more than N times once it has
+// started; 0 checks that ticks and frames don't touch the heap at all.
+// --record writes every game of the tournament to PATH, in game order,
+// as replays (see Replay.h). --replay plays back every game of such a
+// file and fails if one doesn't end the way it was recorded; with
+// --archive it turns them into an archive with keyframes instead (see
+// ReplayArchive.h). --archive alone plays back every game of an
+// archive, read through a memory mapping. With --seek it only puts the
+// game at that tick, prints it and how long that took and, with
+// --frame, saves it drawn as a PPM. --cycles is where the hamilton agent
+// keeps its cycle tables, the working directory by default.
+// --mcts-budget and --mcts-threads set how long the mcts agent searches
+// per move and on how many threads (its share of SPEED by default, and
+// the cores split between the games played at once, so all of them with
+// --threads 1). More threads than that are refused.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cwchar>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+
+#include "Snake.h"
+#include "Agent.h"
+#include "SnakeBatch.h"
+#include "TaskScheduler.h"
+#include "Rng.h"
+#include "SoftPaint.h"
+#include "Profiler.h"
+#include "AllocationCounter.h"
+#include "Replay.h"
+#include "ReplayArchive.h"
+#include "Hamilton.h"
+#include "Mcts.h"
+
+static const int GAME_END_KINDS = 5;
+static const char* GAME_END_NAMES[GAME_END_KINDS] = { "none", "wall", "self", "won", "timeout" };
+
+struct SimOptions {
+	long long games = 1000;
+	std::vector<std::string> agents = { "greedy" };
+	std::vector<BoardSize> boards = { DEFAULT_BOARD };
+	uint64_t seed = 1;
+	long long max_ticks = 100000; // games that run longer than this are cut short
+	int threads = 0;
+	int batch = 0;
+	std::string frame_path;
+	std::string profile_path;
+	long long max_allocations = -1; // not checked
+	std::string record_path;
+	std::string replay_path;
+	std::string archive_path;
+	long long seek_game = -1; // no --seek
+	long long seek_tick = 0;
+	std::string cycle_directory;
+	MctsSettings mcts;
+};
+
+// Results of one agent on one board. Each worker fills its own copy and
+// they are only added up after all games are done.
+struct SimTotals {
+	long long games = 0;
+	long long ticks = 0;
+	long long len = 0;
+	int best_len = 0;
+	long long ends[GAME_END_KINDS] = {};
+	long long most_allocations = 0; // by one game once it was started
+
+	inline void add(long long game_ticks, int game_len, GameEnd end, long long game_allocations = 0) {
+		games++;
+		if (game_allocations > most_allocations) {
+			most_allocations = game_allocations;
+		}
+		ticks += game_ticks;
+		len += game_len;
+		if (game_len > best_len) {
+			best_len = game_len;
+		}
+		ends[(int) end]++;
+	}
+
+	void merge(const SimTotals& other) {
+		games += other.games;
+		ticks += other.ticks;
+		len += other.len;
+		if (other.best_len > best_len) {
+			best_len = other.best_len;
+		}
+		for (int i = 0; i < GAME_END_KINDS; i++) {
+			ends[i] += other.ends[i];
+		}
+		if (other.most_allocations > most_allocations) {
+			most_allocations = other.most_allocations;
+		}
+	}
+};
+
+// Where a worker keeps the replay of one game of the tournament
+struct RecordedGame {
+	int64_t task;
+	std::size_t offset;
+	std::size_t size;
+};
+
+static void printUsage() {
+	std::cerr << "usage: snake-sim [--games N] [--agent A[,A...]] [--board WxH[,WxH...]] [--seed S]\n"
+		"                 [--max-ticks T] [--threads T] [--batch B] [--frame PATH]\n"
+		"                 [--profile PATH] [--max-allocations N] [--record PATH]\n"
+		"                 [--cycles DIR] [--mcts-budget MS] [--mcts-threads T]\n"
+		"       snake-sim --replay PATH [--threads T] [--archive OUT]\n"
+		"       snake-sim --archive PATH [--threads T] [--seek GAME:TICK [--frame PATH]]\n";
+}
+
+static std::vector<std::string> splitList(const std::string& value) {
+	std::vector<std::string> items;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		items.push_back(item);
+	}
+	return items;
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (arg == "--games") {
+			options.games = std::atoll(value.c_str());
+		}
+		else if (arg == "--agent") {
+			options.agents = splitList(value);
+		}
+		else if (arg == "--seed") {
+			options.seed = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (arg == "--max-ticks") {
+			options.max_ticks = std::atoll(value.c_str());
+		}
+		else if (arg == "--board") {
+			options.boards.clear();
+			for (const std::string& item : splitList(value)) {
+				BoardSize board;
+				if (std::sscanf(item.c_str(), "%dx%d", &board.width, &board.height) != 2) {
+					return false;
+				}
+				options.boards.push_back(board);
+			}
+		}
+		else if (arg == "--threads") {
+			options.threads = std::atoi(value.c_str());
+		}
+		else if (arg == "--batch") {
+			options.batch = std::atoi(value.c_str());
+		}
+		else if (arg == "--frame") {
+			options.frame_path = value;
+		}
+		else if (arg == "--profile") {
+			options.profile_path = value;
+		}
+		else if (arg == "--max-allocations") {
+			options.max_allocations = std::atoll(value.c_str());
+		}
+		else if (arg == "--record") {
+			options.record_path = value;
+		}
+		else if (arg == "--replay") {
+			options.replay_path = value;
+		}
+		else if (arg == "--archive") {
+			options.archive_path = value;
+		}
+		else if (arg == "--cycles") {
+			options.cycle_directory = value;
+		}
+		else if (arg == "--mcts-budget") {
+			options.mcts.budget = (float) std::atof(value.c_str()) / 1000;
+		}
+		else if (arg == "--mcts-threads") {
+			options.mcts.threads = std::atoi(value.c_str());
+		}
+		else if (arg == "--seek") {
+			if (std::sscanf(value.c_str(), "%lld:%lld", &options.seek_game, &options.seek_tick) != 2 ||
+				options.seek_game < 0 || options.seek_tick < 0) {
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	for (const BoardSize& board : options.boards) {
+		// the snake starts two cells long in the top row
+		if (board.width < 2 || board.height < 1 || board.width > 4096 || board.height > 4096) {
+			return false;
+		}
+	}
+	// a SnakeBatch counts ticks in 32 bits
+	if (options.batch > 0 && options.max_ticks > INT_MAX) {
+		return false;
+	}
+	return options.games > 0 && options.max_ticks > 0 && options.batch >= 0 && options.threads >= 0 &&
+		options.mcts.budget >= 0 && options.mcts.threads >= 0 &&
+		!options.agents.empty() && !options.boards.empty() &&
+		options.games * (long long) (options.agents.size() * options.boards.size()) <= UINT32_MAX;
+}
+
+// Plays every (agent, board, game) on the scheduler; returns totals
+// indexed by agent * boards + board
+static std::vector<SimTotals> runTournament(const SimOptions& options) {
+	int agent_count = (int) options.agents.size();
+	int board_count = (int) options.boards.size();
+	int pairings = agent_count * board_count;
+	TaskScheduler scheduler(options.threads);
+	int workers = scheduler.threadCount();
+
+	// Everything a worker touches is its own, built lazily on first use
+	struct WorkerState {
+		std::vector<std::unique_ptr<Agent>> agents;
+		std::vector<std::unique_ptr<Snake>> snakes;
+		std::vector<SimTotals> totals;
+		// with --record, the games it played and where they are in replays
+		ReplayWriter writer;
+		std::vector<uint8_t> replays;
+		std::vector<RecordedGame> recorded;
+	};
+	bool recording = !options.record_path.empty();
+	std::vector<WorkerState> states(workers);
+	for (WorkerState& state : states) {
+		state.agents.resize(agent_count);
+		state.snakes.resize(board_count);
+		state.totals.resize(pairings);
+	}
+
+	scheduler.parallelFor(options.games * pairings, [&](int64_t task, int worker) {
+		int pairing = (int) (task % pairings);
+		int64_t game = task / pairings;
+		int agent_index = pairing / board_count;
+		int board_index = pairing % board_count;
+
+		WorkerState& state = states[worker];
+		std::unique_ptr<Agent>& agent = state.agents[agent_index];
+		if (agent == nullptr) {
+			agent = createAgent(options.agents[agent_index]);
+		}
+		std::unique_ptr<Snake>& snake = state.snakes[board_index];
+		if (snake == nullptr) {
+			snake = std::make_unique<Snake>(nullptr, options.boards[board_index], options.seed);
+		}
+
+		snake->restart(options.seed, (uint64_t) game);
+		agent->reset(options.boards[board_index], options.seed, (uint64_t) game);
+		if (recording) {
+			state.writer.reserve((uint64_t) options.max_ticks);
+			state.writer.begin(ReplayHeader{ options.boards[board_index], options.seed, (uint64_t) game });
+		}
+		long long allocations = threadAllocationCount();
+		long long ticks = 0;
+		while (snake->running && ticks < options.max_ticks) {
+			snake->turn(agent->decide(*snake));
+			if (recording) {
+				state.writer.record(*snake);
+			}
+			snake->moveOneStep();
+			ticks++;
+		}
+		allocations = threadAllocationCount() - allocations;
+		GameEnd end = snake->running ? GameEnd::TIMEOUT : snake->game_end;
+		state.totals[pairing].add(ticks, snake->len, end, allocations);
+		if (recording) {
+			state.writer.finish(*snake, end);
+			const std::vector<uint8_t>& replay = state.writer.data();
+			state.recorded.push_back(RecordedGame{ task, state.replays.size(), replay.size() });
+			state.replays.insert(state.replays.end(), replay.begin(), replay.end());
+		}
+	});
+
+	std::vector<SimTotals> totals(pairings);
+	for (const WorkerState& state : states) {
+		for (int pairing = 0; pairing < pairings; pairing++) {
+			totals[pairing].merge(state.totals[pairing]);
+		}
+	}
+
+	if (recording) {
+		// in the order of the games, however they were scheduled
+		std::vector<std::pair<RecordedGame, const WorkerState*>> games;
+		for (const WorkerState& state : states) {
+			for (const RecordedGame& game : state.recorded) {
+				games.push_back({ game, &state });
+			}
+		}
+		std::sort(games.begin(), games.end(), [](const auto& a, const auto& b) {
+			return a.first.task < b.first.task;
+		});
+		std::ofstream file(options.record_path, std::ios::binary);
+		for (const auto& [game, state] : games) {
+			file.write((const char*) state->replays.data() + game.offset, (std::streamsize) game.size);
+		}
+		if (!file.good()) {
+			std::cerr << "cannot write " << options.record_path << "\n";
+			totals.clear();
+		}
+	}
+	return totals;
+}
+
+// Plays back the games that start at offsets in the size bytes of
+// data, spread over the threads; replay_bytes is what they take
+static int playReplays(const SimOptions& options, const uint8_t* data, std::size_t size,
+	const std::vector<std::size_t>& offsets, std::size_t replay_bytes) {
+	auto start = std::chrono::steady_clock::now();
+	TaskScheduler scheduler(options.threads);
+	struct WorkerState {
+		std::unique_ptr<Snake> snake;
+		SimTotals totals;
+		long long mismatches = 0;
+	};
+	std::vector<WorkerState> states(scheduler.threadCount());
+	scheduler.parallelFor((int64_t) offsets.size(), [&](int64_t task, int worker) {
+		WorkerState& state = states[worker];
+		ReplayReader reader(data, size);
+		reader.seek(offsets[task]);
+		ReplayHeader header;
+		reader.begin(header);
+		BoardSize board = header.board;
+		if (state.snake == nullptr || state.snake->getBoardSize().width != board.width ||
+			state.snake->getBoardSize().height != board.height) {
+			state.snake = std::make_unique<Snake>(nullptr, board, header.seed);
+		}
+		ReplayResult result;
+		if (playReplay(reader, header, *state.snake, result)) {
+			state.mismatches++;
+		}
+		state.totals.add((long long) result.ticks, result.len, result.end);
+	});
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	SimTotals totals;
+	long long mismatches = 0;
+	for (const WorkerState& state : states) {
+		totals.merge(state.totals);
+		mismatches += state.mismatches;
+	}
+	std::cout << "games: " << totals.games << ", mean len: " << std::fixed << std::setprecision(2)
+		<< (totals.games ? (double) totals.len / totals.games : 0.0) << ", best: " << totals.best_len
+		<< ", mismatches: " << mismatches << ", bytes/game: " << std::setprecision(1)
+		<< (totals.games ? (double) replay_bytes / totals.games : 0.0) << "\n";
+	std::cout << "ticks/s: " << std::setprecision(0) << totals.ticks / elapsed.count() << "\n";
+	return mismatches ? 1 : 0;
+}
+
+// Plays back every game of a replay file, or with --archive writes them
+// to an archive
+static int runReplays(const SimOptions& options) {
+	std::vector<uint8_t> bytes;
+	if (readReplayFile(options.replay_path, bytes)) {
+		std::cerr << "cannot read " << options.replay_path << "\n";
+		return 1;
+	}
+	// where every game starts; this only reads the varints, which is
+	// far quicker than playing them
+	std::vector<std::size_t> offsets;
+	ReplayReader scanner(bytes.data(), bytes.size());
+	while (!scanner.atEnd()) {
+		offsets.push_back(scanner.offset());
+		ReplayHeader header;
+		if (scanner.begin(header) || scanner.skip()) {
+			std::cerr << "malformed game at byte " << offsets.back() << "\n";
+			return 1;
+		}
+	}
+	if (options.archive_path.empty()) {
+		return playReplays(options, bytes.data(), bytes.size(), offsets, bytes.size());
+	}
+
+	ArchiveWriter writer;
+	if (writer.open(options.archive_path)) {
+		std::cerr << "cannot write " << options.archive_path << "\n";
+		return 1;
+	}
+	offsets.push_back(bytes.size());
+	for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+		if (writer.addGame(bytes.data() + offsets[i], offsets[i + 1] - offsets[i])) {
+			std::cerr << "game " << i << " doesn't replay or cannot be written\n";
+			return 1;
+		}
+	}
+	if (writer.finish()) {
+		std::cerr << "cannot write " << options.archive_path << "\n";
+		return 1;
+	}
+	std::cout << "games: " << offsets.size() - 1 << ", archive bytes: "
+		<< std::filesystem::file_size(options.archive_path) << "\n";
+	return 0;
+}
+
+// Puts one game of an archive at one tick and shows it
+static int runSeek(const SimOptions& options, const ArchiveReader& archive) {
+	ArchiveGame game;
+	if (archive.game((uint64_t) options.seek_game, game)) {
+		std::cerr << "no game " << options.seek_game << "\n";
+		return 1;
+	}
+	std::unique_ptr<SoftPaint> paint;
+	if (!options.frame_path.empty()) {
+		paint = std::make_unique<SoftPaint>(game.board);
+	}
+	Snake snake(paint.get(), game.board, 0);
+	ReplayReader reader(archive.data(), archive.size());
+
+	auto start = std::chrono::steady_clock::now();
+	if (archive.seek((uint64_t) options.seek_game, (uint64_t) options.seek_tick, snake, reader)) {
+		std::cerr << "cannot seek to tick " << options.seek_tick << " of game " << options.seek_game
+			<< ", which has " << game.ticks << "\n";
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::pair<int, int> head = snake.getHead();
+	std::cout << "game " << options.seek_game << " tick " << options.seek_tick << "/" << game.ticks
+		<< ": len " << snake.len << ", head " << head.first << "," << head.second
+		<< ", candy " << snake.candy.first << "," << snake.candy.second
+		<< (snake.running ? "" : ", over") << "\n";
+	std::cout << "seek us: " << std::fixed << std::setprecision(1) << elapsed.count() * 1e6 << "\n";
+	if (paint != nullptr) {
+		paint->beginDraw();
+		if (snake.draw() || paint->endDraw() || paint->savePPM(options.frame_path.c_str())) {
+			std::cerr << "cannot write " << options.frame_path << "\n";
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Plays back every game of an archive from the mapped file, or with
+// --seek one tick of one game
+static int runArchive(const SimOptions& options) {
+	ArchiveReader archive;
+	if (archive.open(options.archive_path)) {
+		std::cerr << "cannot read " << options.archive_path << "\n";
+		return 1;
+	}
+	if (options.seek_game >= 0) {
+		return runSeek(options, archive);
+	}
+	std::vector<std::size_t> offsets;
+	std::size_t replay_bytes = 0;
+	for (uint64_t i = 0; i < archive.gameCount(); i++) {
+		ArchiveGame game;
+		if (archive.game(i, game)) {
+			std::cerr << "malformed index entry " << i << "\n";
+			return 1;
+		}
+		offsets.push_back((std::size_t) game.replay_offset);
+		replay_bytes += (std::size_t) game.replay_size;
+	}
+	archive.adviseScan();
+	return playReplays(options, archive.data(), archive.size(), offsets, replay_bytes);
+}
+
+// The same two policies as RandomAgent and GreedyAgent, on batch cells
+static Action batchDecision(const SnakeBatch& batch, int game, bool greedy, Rng& rng) {
+	static const Action ACTIONS[3] = { Action::STRAIGHT, Action::LEFT, Action::RIGHT };
+	static const int TURNS[3] = { 0, 3, 1 };
+	int width = batch.getBoardSize().width + 2;
+	int head = batch.headOf(game);
+	int candy = batch.candyOf(game);
+
+	Action safe[3];
+	int count = 0;
+	Action best = Action::STRAIGHT;
+	int best_dist = -1;
+	for (int a = 0; a < 3; a++) {
+		int next = batch.neighbour(head, (batch.orientationOf(game) + TURNS[a]) % 4);
+		if (!batch.isFree(game, next)) {
+			continue;
+		}
+		safe[count++] = ACTIONS[a];
+		int dist = std::abs(next / width - candy / width) + std::abs(next % width - candy % width);
+		if (best_dist == -1 || dist < best_dist) {
+			best = ACTIONS[a];
+			best_dist = dist;
+		}
+	}
+	if (greedy || count == 0) {
+		return best;
+	}
+	return safe[rng.below(count)];
+}
+
+static SimTotals runBatch(const SimOptions& options) {
+	SimTotals totals;
+	bool greedy = options.agents[0] == "greedy"; // random otherwise, see main
+	SnakeBatch batch(options.batch, options.boards[0], options.seed, (int) options.max_ticks);
+	std::vector<Action> actions(batch.size());
+	Rng rng(~options.seed);
+	while (totals.games < options.games) {
+		for (int i = 0; i < batch.size(); i++) {
+			actions[i] = batchDecision(batch, i, greedy, rng);
+		}
+		batch.step(actions.data());
+		const uint8_t* dones = batch.getDones();
+		for (int i = 0; i < batch.size(); i++) {
+			if (dones[i] && totals.games < options.games) {
+				totals.add(batch.getLastTicks()[i], batch.getLastLengths()[i], batch.getLastEnds()[i]);
+			}
+		}
+	}
+	return totals;
+}
+
+// Draws one game the way the window would and times the frames; after
+// the first one they only repaint the cells that changed
+static int runFrames(const SimOptions& options) {
+	SoftPaint paint(options.boards[0]);
+	Snake snake(&paint, options.boards[0], options.seed);
+	std::unique_ptr<Agent> agent = createAgent(options.agents[0]);
+	agent->reset(options.boards[0], options.seed, 0);
+
+	long long frames = 0;
+	long long allocations = 0; // from the second frame on
+	std::chrono::duration<double> drawing(0);
+	while (snake.running && frames < options.max_ticks) {
+		if (frames == 1) {
+			allocations = allocationCount();
+		}
+		auto start = std::chrono::steady_clock::now();
+		paint.beginDraw();
+		if (snake.draw()) {
+			return 1;
+		}
+		{
+			PROFILE_SCOPE(PHASE_PRESENT);
+			if (paint.endDraw()) {
+				return 1;
+			}
+		}
+		drawing += std::chrono::steady_clock::now() - start;
+		frames++;
+
+		snake.turn(agent->decide(snake));
+		snake.moveOneStep();
+	}
+	allocations = frames > 1 ? allocationCount() - allocations : 0;
+
+	std::cout << "frames: " << frames << ", length: " << snake.len << ", ms/frame: "
+		<< std::fixed << std::setprecision(3) << drawing.count() * 1000 / frames << "\n";
+	if (paint.savePPM(options.frame_path.c_str())) {
+		std::cerr << "cannot write " << options.frame_path << "\n";
+		return 1;
+	}
+	if (options.max_allocations >= 0 && allocations > options.max_allocations) {
+		std::cerr << "frames after the first one allocated " << allocations << " times\n";
+		return 1;
+	}
+
+	// then the game-over screen, which is only rendered the first time
+	const int idle_frames = 100;
+	wchar_t text[64];
+	int len = std::swprintf(text, 64, L"Kliknij R aby zrestartować\nUzyskany wynik: %d", snake.len);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < idle_frames; i++) {
+		paint.beginDraw();
+		if (paint.drawGameOver(text, len) || paint.endDraw()) {
+			return 1;
+		}
+	}
+	drawing = std::chrono::steady_clock::now() - start;
+	std::cout << "game over ms/frame: " << drawing.count() * 1000 / idle_frames << "\n";
+	return 0;
+}
+
+static int saveProfile(const SimOptions& options) {
+	if (options.profile_path.empty()) {
+		return 0;
+	}
+	if (profiler.write(options.profile_path.c_str())) {
+		std::cerr << "cannot write " << options.profile_path << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+static void printTotals(const std::string& agent, BoardSize board, const SimTotals& totals) {
+	std::cout << std::left << std::setw(10) << agent
+		<< std::setw(10) << (std::to_string(board.width) + "x" + std::to_string(board.height))
+		<< std::right << std::setw(10) << totals.games
+		<< std::setw(12) << std::fixed << std::setprecision(2) << (double) totals.len / totals.games
+		<< std::setw(8) << totals.best_len
+		<< std::setw(12) << std::setprecision(1) << (double) totals.ticks / totals.games;
+	for (int i = 1; i < GAME_END_KINDS; i++) {
+		std::cout << std::setw(9) << totals.ends[i];
+	}
+	std::cout << "\n";
+}
+
+int main(int argc, char** argv) {
+	SimOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return 1;
+	}
+	for (const std::string& name : options.agents) {
+		if (createAgent(name) == nullptr) {
+			std::cerr << "unknown agent: " << name << "\n";
+			return 1;
+		}
+	}
+
+	// every mcts agent searches on a pool of its own, and there is one
+	// for every game played at once, so the cores are shared out
+	if (std::find(options.agents.begin(), options.agents.end(), "mcts") != options.agents.end()) {
+		int cores = std::max(1, (int) std::thread::hardware_concurrency());
+		int games_at_once = options.threads > 0 ? options.threads : cores;
+		if (options.mcts.threads == 0) {
+			options.mcts.threads = std::max(1, cores / games_at_once);
+		}
+		else if (games_at_once > 1 && games_at_once * options.mcts.threads > cores) {
+			std::cerr << "--mcts-threads " << options.mcts.threads << " for each of " << games_at_once <<
+				" games at once is more than the " << cores << " cores\n";
+			return 1;
+		}
+	}
+	setMctsSettings(options.mcts);
+	if (!options.cycle_directory.empty()) {
+		setCycleDirectory(options.cycle_directory);
+	}
+
+	if (!options.profile_path.empty() && !PROFILING) {
+		std::cerr << "--profile needs a build with SNAKE_PROFILE\n";
+		return 1;
+	}
+
+	if (!options.replay_path.empty()) {
+		return runReplays(options);
+	}
+	if (!options.archive_path.empty()) {
+		return runArchive(options);
+	}
+	if (!options.frame_path.empty()) {
+		return runFrames(options) || saveProfile(options);
+	}
+
+	// a batch has no Snake to hand an Agent, it only plays its own
+	// random and greedy policies, one agent on one board
+	if (options.batch > 0 && (options.agents.size() != 1 || options.boards.size() != 1 ||
+		(options.agents[0] != "random" && options.agents[0] != "greedy"))) {
+		std::cerr << "--batch plays one agent, random or greedy, on one board\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<SimTotals> totals;
+	if (options.batch > 0) {
+		totals.push_back(runBatch(options));
+	}
+	else {
+		totals = runTournament(options);
+		if (totals.empty()) {
+			return 1;
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << std::left << std::setw(10) << "agent" << std::setw(10) << "board"
+		<< std::right << std::setw(10) << "games" << std::setw(12) << "mean len" << std::setw(8) << "best"
+		<< std::setw(12) << "mean ticks";
+	for (int i = 1; i < GAME_END_KINDS; i++) {
+		std::cout << std::setw(9) << GAME_END_NAMES[i];
+	}
+	std::cout << "\n";
+
+	long long total_ticks = 0;
+	for (size_t i = 0; i < totals.size(); i++) {
+		size_t board_count = options.boards.size();
+		printTotals(options.agents[i / board_count], options.boards[i % board_count], totals[i]);
+		total_ticks += totals[i].ticks;
+	}
+	std::cout << "ticks/s: " << std::setprecision(0) << total_ticks / elapsed.count() << "\n";
+
+	if (options.max_allocations >= 0) {
+		long long most = 0;
+		for (const SimTotals& pairing : totals) {
+			most = std::max(most, pairing.most_allocations);
+		}
+		if (most > options.max_allocations) {
+			std::cerr << "a game allocated " << most << " times once it was started\n";
+			return 1;
+		}
+	}
+	return saveProfile(options);
+}
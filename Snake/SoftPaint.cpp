@@ -0,0 +1,545 @@
+#include "SoftPaint.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <numbers>
+
+// segments every Bezier curve and the candy are flattened into
+const int CURVE_STEPS = 16;
+const int ELLIPSE_STEPS = 64;
+
+// the font is 5 x 7 dots, a dot is a tenth of FONT_SIZE
+const float DOT_SIZE = FONT_SIZE / 10;
+const int GLYPH_ADVANCE = 6;
+const int LINE_ADVANCE = 9;
+const float SHADOW_OFFSET = 10.0f;
+const float SHADOW_OPACITY = 0.2f;
+
+// fills the board when no background bitmap was loaded
+const Color FIELD_COLOR = { 0.55f, 0.75f, 0.35f };
+
+struct Glyph {
+	char c;
+	uint8_t rows[7]; // five dots per row, the highest bit on the left
+};
+
+static const Glyph FONT[] = {
+	{ 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+	{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+	{ 'D', { 0x1E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1E } },
+	{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+	{ 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+	{ 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+	{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+	{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+	{ 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+	{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+	{ 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+	{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+	{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+	{ 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+	{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+	{ 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+	{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+	{ 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+	{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+	{ 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+	{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+	{ 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+	{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+	{ '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+	{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+	{ '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+	{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+	{ '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+	{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+	{ '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+	{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+	{ '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+	{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+	{ '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+	{ ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+	{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+	{ '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+	{ '!', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 } },
+	{ '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } }
+};
+
+// The font only has capitals, Polish letters lose their accents
+static wchar_t foldLetter(wchar_t c) {
+	static const wchar_t ACCENTED[] = L"ąćęłńóśźżĄĆĘŁŃÓŚŹŻ";
+	static const char PLAIN[] = "ACELNOSZZACELNOSZZ";
+	for (int i = 0; ACCENTED[i]; i++) {
+		if (ACCENTED[i] == c) {
+			return PLAIN[i];
+		}
+	}
+	if (c >= L'a' && c <= L'z') {
+		return c - L'a' + L'A';
+	}
+	return c;
+}
+
+static const Glyph* findGlyph(wchar_t c) {
+	for (const Glyph& glyph : FONT) {
+		if (glyph.c == c) {
+			return &glyph;
+		}
+	}
+	return nullptr;
+}
+
+static uint32_t toPixel(Color color) {
+	auto channel = [](float value) {
+		return (uint32_t) std::lrint(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+	};
+	return 0xff000000u | channel(color.r) << 16 | channel(color.g) << 8 | channel(color.b);
+}
+
+SoftPaint::SoftPaint(BoardSize size, int w, int h) : width(w), height(h), pixels((size_t) w * h, 0xff000000u) {
+	board = size;
+	field_width = cellSize(size);
+	field_height = field_width;
+	resetClip();
+	createShapeCache();
+
+	// room for the largest figure of the game: a frame then never
+	// allocates, only text and layers may
+	size_t longest = ELLIPSE_STEPS;
+	for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+		longest = std::max(longest, shape_cache[shape][0].size());
+	}
+	placed.reserve(longest);
+	// a stroke turns every side into four edges
+	rasterizer.reserve(width, height, 4 * (int) longest);
+	run_fill.reserve(std::max(board.width, board.height));
+	run_outline.reserve(std::max(board.width, board.height));
+}
+
+void SoftPaint::setClip(int x0, int y0, int x1, int y1) {
+	clip_x0 = std::max(x0, 0);
+	clip_y0 = std::max(y0, 0);
+	clip_x1 = std::min(x1, width);
+	clip_y1 = std::min(y1, height);
+	rasterizer.setClip(clip_x0, clip_y0, clip_x1, clip_y1);
+}
+
+void SoftPaint::resetClip() {
+	setClip(0, 0, width, height);
+}
+
+// Same placement as Paint::getCellTransformation: the shape box is scaled
+// to a cell and turned around its center, then moved to the cell at the
+// origin of the board. Curves are flattened on the way.
+void SoftPaint::createShapeCache() {
+	for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+		const ShapePath& path = SHAPE_PATHS[shape];
+		std::vector<ShapePoint> outline = { path.start };
+		for (int i = 0; i < path.count; i++) {
+			const ShapeCommand& command = path.commands[i];
+			if (!command.bezier) {
+				outline.push_back(command.points[0]);
+				continue;
+			}
+			ShapePoint p0 = outline.back();
+			for (int step = 1; step <= CURVE_STEPS; step++) {
+				float t = (float) step / CURVE_STEPS;
+				float u = 1.0f - t;
+				float b0 = u * u * u;
+				float b1 = 3 * u * u * t;
+				float b2 = 3 * u * t * t;
+				float b3 = t * t * t;
+				outline.push_back({
+					b0 * p0.x + b1 * command.points[0].x + b2 * command.points[1].x + b3 * command.points[2].x,
+					b0 * p0.y + b1 * command.points[0].y + b2 * command.points[1].y + b3 * command.points[2].y
+				});
+			}
+		}
+
+		for (int orientation = 0; orientation < 4; orientation++) {
+			float angle = orientation * std::numbers::pi_v<float> / 2;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			std::vector<RasterPoint>& points = shape_cache[shape][orientation];
+			points.clear();
+			for (ShapePoint p : outline) {
+				float x = (p.x - SHAPE_CENTER.x) * field_height / SHAPE_SIZE;
+				float y = (p.y - SHAPE_CENTER.y) * field_width / SHAPE_SIZE;
+				points.push_back({
+					x * c - y * s + field_height / 2,
+					x * s + y * c + field_width / 2
+				});
+			}
+		}
+	}
+}
+
+void SoftPaint::fillPolygon(const std::vector<RasterPoint>& points, float dx, float dy, Color color) {
+	placed.resize(points.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		placed[i] = { points[i].x + dx, points[i].y + dy };
+	}
+	rasterizer.addPolygon(placed.data(), (int) placed.size());
+	rasterizer.blend(pixels.data(), width, height, toPixel(color), 1.0f);
+	rasterizer.addStroke(placed.data(), (int) placed.size(), 1.0f);
+	rasterizer.blend(pixels.data(), width, height, toPixel({ color.r / 2, color.g / 2, color.b / 2 }), 1.0f);
+}
+
+void SoftPaint::fillShape(int shape, int x, int y, int orientation, Color color) {
+	fillPolygon(
+		shape_cache[shape][orientation % 4],
+		(float) field_height * y + MARGIN, (float) field_width * x + MARGIN,
+		color
+	);
+}
+
+void SoftPaint::fillRect(float x0, float y0, float x1, float y1, Color color) {
+	if (x1 <= clip_x0 || x0 >= clip_x1 || y1 <= clip_y0 || y0 >= clip_y1) {
+		return;
+	}
+	RasterPoint corners[4] = { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 } };
+	rasterizer.addPolygon(corners, 4);
+	rasterizer.blend(pixels.data(), width, height, toPixel(color), 1.0f);
+}
+
+void SoftPaint::drawBitmap(const Bitmap& bitmap, int x0, int y0, int x1, int y1) {
+	if (bitmap.pixels.empty() || x1 <= x0 || y1 <= y0) {
+		return;
+	}
+	for (int y = std::max(y0, clip_y0); y < std::min(y1, clip_y1); y++) {
+		const uint32_t* source = bitmap.pixels.data() + (size_t) ((y - y0) * bitmap.height / (y1 - y0)) * bitmap.width;
+		uint32_t* target = pixels.data() + (size_t) y * width;
+		for (int x = std::max(x0, clip_x0); x < std::min(x1, clip_x1); x++) {
+			target[x] = source[(x - x0) * bitmap.width / (x1 - x0)];
+		}
+	}
+}
+
+void SoftPaint::addGlyph(wchar_t c, float x, float y) {
+	const Glyph* glyph = findGlyph(foldLetter(c));
+	if (!glyph) {
+		glyph = findGlyph('?');
+	}
+	for (int row = 0; row < 7; row++) {
+		for (int column = 0; column < 5; column++) {
+			if (!(glyph->rows[row] & (0x10 >> column))) {
+				continue;
+			}
+			float left = x + column * DOT_SIZE;
+			float top = y + row * DOT_SIZE;
+			RasterPoint dot[4] = {
+				{ left, top }, { left + DOT_SIZE, top },
+				{ left + DOT_SIZE, top + DOT_SIZE }, { left, top + DOT_SIZE }
+			};
+			rasterizer.addPolygon(dot, 4);
+		}
+	}
+}
+
+int SoftPaint::loadPPM(const char* file_name, Bitmap& bitmap) {
+	FILE* file = fopen(file_name, "rb");
+	if (!file) {
+		return 1;
+	}
+	int w, h, max_value;
+	if (fscanf(file, "P6 %d %d %d", &w, &h, &max_value) != 3 || w <= 0 || h <= 0 || max_value != 255) {
+		fclose(file);
+		return 1;
+	}
+	fgetc(file); // the single whitespace before the data
+
+	std::vector<uint8_t> data((size_t) w * h * 3);
+	size_t read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+	if (read != data.size()) {
+		return 1;
+	}
+
+	bitmap.width = w;
+	bitmap.height = h;
+	bitmap.pixels.resize((size_t) w * h);
+	for (size_t i = 0; i < bitmap.pixels.size(); i++) {
+		bitmap.pixels[i] = 0xff000000u | data[3 * i] << 16 | data[3 * i + 1] << 8 | data[3 * i + 2];
+	}
+	return 0;
+}
+
+int SoftPaint::loadBitmaps(const char* bg_file_name, const char* logo_file_name) {
+	board_layer.clear();
+	game_over_layer.clear();
+	frame_kept = false;
+	game_over_shown = false;
+	if (loadPPM(bg_file_name, bg_bitmap)) {
+		return 1;
+	}
+	return loadPPM(logo_file_name, logo_bitmap);
+}
+
+void SoftPaint::setBackground(Color color) {
+	uint32_t pixel = toPixel(color);
+	for (int y = clip_y0; y < clip_y1; y++) {
+		std::fill(pixels.begin() + (size_t) y * width + clip_x0, pixels.begin() + (size_t) y * width + clip_x1, pixel);
+	}
+}
+
+// Drawing goes to the layer until endLayer(); layers cover the whole
+// screen, so there must be no clip
+void SoftPaint::beginLayer(std::vector<uint32_t>& layer) {
+	pixels.swap(layer);
+	pixels.assign((size_t) width * height, 0xff000000u);
+}
+
+void SoftPaint::endLayer(std::vector<uint32_t>& layer) {
+	pixels.swap(layer);
+}
+
+// Copies the clipped part of the layer to the screen
+void SoftPaint::drawLayer(const std::vector<uint32_t>& layer) {
+	for (int y = clip_y0; y < clip_y1; y++) {
+		size_t row = (size_t) y * width;
+		std::copy(layer.begin() + row + clip_x0, layer.begin() + row + clip_x1, pixels.begin() + row + clip_x0);
+	}
+}
+
+void SoftPaint::beginDraw() {
+}
+
+int SoftPaint::endDraw() {
+	return 0;
+}
+
+void SoftPaint::writeText(const wchar_t* text, Color color, int len, float x, float y) {
+	// the shadow first, then the text over it
+	for (int pass = 0; pass < 2; pass++) {
+		float offset = pass == 0 ? SHADOW_OFFSET : 0.0f;
+		float pen_x = x + offset;
+		float pen_y = y + offset;
+		for (int i = 0; i < len; i++) {
+			if (text[i] == L'\n') {
+				pen_x = x + offset;
+				pen_y += LINE_ADVANCE * DOT_SIZE;
+				continue;
+			}
+			if (text[i] != L' ') {
+				addGlyph(text[i], pen_x, pen_y);
+			}
+			pen_x += GLYPH_ADVANCE * DOT_SIZE;
+		}
+		if (pass == 0) {
+			rasterizer.blend(pixels.data(), width, height, toPixel({ 0.0f, 0.0f, 0.0f }), SHADOW_OPACITY);
+		}
+		else {
+			rasterizer.blend(pixels.data(), width, height, toPixel(color), 1.0f);
+		}
+	}
+}
+
+void SoftPaint::drawBgBitmap() {
+	drawBitmap(bg_bitmap, 0, 0, WIN_WIDTH, WIN_HEIGHT);
+}
+
+void SoftPaint::drawLogo() {
+	drawBitmap(logo_bitmap, WIN_WIDTH / 2, WIN_HEIGHT / 2, WIN_WIDTH, WIN_HEIGHT);
+}
+
+int SoftPaint::drawStraightSegment(int x, int y, int orientation, Color color) {
+	fillShape(SHAPE_STRAIGHT, x, y, orientation, color);
+	return 0;
+}
+
+// The straight shape of the first cell, with its far end moved to the
+// last one, filled in bands of one cell with the colors of the cells
+int SoftPaint::drawStraightRun(int x, int y, int orientation, int length, const Color* colors) {
+	const std::vector<RasterPoint>& points = shape_cache[SHAPE_STRAIGHT][orientation % 4];
+	// the shape cache turns the straight shape along orientation
+	float along_x = (float) ORIENTATION_DY[orientation % 4];
+	float along_y = (float) ORIENTATION_DX[orientation % 4];
+	float left = (float) field_height * y + MARGIN;
+	float top = (float) field_width * x + MARGIN;
+	float stretch = (float) (length - 1) * field_width;
+	placed.resize(points.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		RasterPoint p = { points[i].x + left, points[i].y + top };
+		float along = (points[i].x - field_height / 2) * along_x + (points[i].y - field_width / 2) * along_y;
+		if (along > 0) {
+			p.x += stretch * along_x;
+			p.y += stretch * along_y;
+		}
+		placed[i] = p;
+	}
+
+	// bands go left to right or top to bottom, so runs going up or
+	// left take their colors from the end
+	bool reversed = along_x + along_y < 0;
+	run_fill.resize(length);
+	run_outline.resize(length);
+	for (int i = 0; i < length; i++) {
+		Color color = colors[reversed ? length - 1 - i : i];
+		run_fill[i] = toPixel(color);
+		run_outline[i] = toPixel({ color.r / 2, color.g / 2, color.b / 2 });
+	}
+	bool vertical = along_y != 0;
+	float start = vertical ? top : left;
+	if (reversed) {
+		start -= stretch;
+	}
+
+	rasterizer.addPolygon(placed.data(), (int) placed.size());
+	rasterizer.blendBands(pixels.data(), width, height, run_fill.data(), length, start, (float) field_width, vertical, 1.0f);
+	rasterizer.addStroke(placed.data(), (int) placed.size(), 1.0f);
+	rasterizer.blendBands(pixels.data(), width, height, run_outline.data(), length, start, (float) field_width, vertical, 1.0f);
+	return 0;
+}
+
+int SoftPaint::drawCurvedSegment(int x, int y, int orientation, Color color) {
+	fillShape(SHAPE_CURVED, x, y, orientation + 2, color);
+	return 0;
+}
+
+int SoftPaint::drawTail(int x, int y, int orientation) {
+	fillShape(SHAPE_TAIL, x, y, orientation + 3, TAIL_COLOR);
+	return 0;
+}
+
+int SoftPaint::drawHead(int x, int y, int orientation) {
+	fillShape(SHAPE_HEAD, x, y, orientation + 1, HEAD_COLOR);
+	return 0;
+}
+
+// A rectangle outline centered on the edges, like Paint::drawBorders
+void SoftPaint::drawBorders(float border_width) {
+	float x0 = (float) MARGIN - border_width;
+	float y0 = (float) MARGIN - border_width;
+	float x1 = (float) MARGIN + board.width * field_width;
+	float y1 = (float) MARGIN + board.height * field_height;
+	float half = border_width / 2;
+	Color red = { 1.0f, 0.0f, 0.0f };
+	fillRect(x0 - half, y0 - half, x1 + half, y0 + half, red);
+	fillRect(x0 - half, y1 - half, x1 + half, y1 + half, red);
+	fillRect(x0 - half, y0 - half, x0 + half, y1 + half, red);
+	fillRect(x1 - half, y0 - half, x1 + half, y1 + half, red);
+}
+
+int SoftPaint::drawCandy(int x, int y, Color color) {
+	float center_x = (float) field_height * y + field_height / 2 + MARGIN;
+	float center_y = (float) field_width * x + field_width / 2 + MARGIN;
+	float radius_x = (float) (field_height / 2);
+	float radius_y = (float) (field_width / 2);
+	placed.resize(ELLIPSE_STEPS);
+	for (int i = 0; i < ELLIPSE_STEPS; i++) {
+		float angle = 2 * std::numbers::pi_v<float> * i / ELLIPSE_STEPS;
+		placed[i] = { center_x + radius_x * std::cos(angle), center_y + radius_y * std::sin(angle) };
+	}
+	rasterizer.addPolygon(placed.data(), ELLIPSE_STEPS);
+	rasterizer.blend(pixels.data(), width, height, toPixel(color), 1.0f);
+	// Paint outlines the candy with green and blue swapped, keep it alike
+	rasterizer.addStroke(placed.data(), ELLIPSE_STEPS, 1.0f);
+	rasterizer.blend(pixels.data(), width, height, toPixel({ color.r / 2, color.b / 2, color.g / 2 }), 1.0f);
+	return 0;
+}
+
+int SoftPaint::drawEatingAnimation(int x, int y, int orientation, Color color) {
+	fillShape(SHAPE_EATING_PARTICLE, x, y, orientation + 3, color);
+	fillShape(SHAPE_EATING_PARTICLE, x, y, orientation + 4, color);
+	return 0;
+}
+
+// A full frame repaints everything. Otherwise each changed cell, grown by
+// half a cell to catch shapes spilling over from around it, is cleared to
+// the background and the shapes reaching into it are drawn again, clipped
+int SoftPaint::drawCommands(CommandBuffer& commands) {
+	if (board_layer.empty()) {
+		// everything the snake is drawn over
+		beginLayer(board_layer);
+		if (bg_bitmap.pixels.empty()) {
+			setBackground(FIELD_COLOR);
+		}
+		else {
+			drawBgBitmap();
+		}
+		drawBorders(BOARDER_WIDTH);
+		endLayer(board_layer);
+	}
+
+	game_over_shown = false;
+	const ChangeSet& dirty = commands.getDirty();
+	if (dirty.isAll()) {
+		drawLayer(board_layer);
+		frame_kept = true;
+		return commands.replay(this);
+	}
+	for (int i = 0; i < dirty.size(); i++) {
+		int left = field_height * dirty.at(i).second + MARGIN - field_height / 2;
+		int top = field_width * dirty.at(i).first + MARGIN - field_width / 2;
+		setClip(left, top, left + 2 * field_height, top + 2 * field_width);
+		drawLayer(board_layer);
+		int result = commands.replayAround(this, dirty.at(i));
+		resetClip();
+		if (result) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+bool SoftPaint::keepsLastFrame() const {
+	return frame_kept;
+}
+
+int SoftPaint::drawGameOver(const wchar_t* text, int len) {
+	bool same_text = game_over_text.compare(0, std::wstring::npos, text, len) == 0;
+	if (game_over_shown && same_text) {
+		return 0; // the frame already shows it
+	}
+	if (game_over_layer.empty() || !same_text) {
+		beginLayer(game_over_layer);
+		setBackground({ 0.8f, 0.8f, 0.8f });
+		drawLogo();
+		writeText(text, { 0.0f, 0.0f, 0.0f }, len, MARGIN, MARGIN);
+		endLayer(game_over_layer);
+		game_over_text.assign(text, len);
+	}
+	drawLayer(game_over_layer);
+	game_over_shown = true;
+	frame_kept = false; // the board is gone from the screen
+	return 0;
+}
+
+const uint32_t* SoftPaint::getPixels() const {
+	return pixels.data();
+}
+
+int SoftPaint::getWidth() const {
+	return width;
+}
+
+int SoftPaint::getHeight() const {
+	return height;
+}
+
+int SoftPaint::savePPM(const char* file_name) const {
+	FILE* file = fopen(file_name, "wb");
+	if (!file) {
+		return 1;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	std::vector<uint8_t> row((size_t) width * 3);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			uint32_t pixel = pixels[(size_t) y * width + x];
+			row[3 * x] = (uint8_t) (pixel >> 16);
+			row[3 * x + 1] = (uint8_t) (pixel >> 8);
+			row[3 * x + 2] = (uint8_t) pixel;
+		}
+		if (fwrite(row.data(), 1, row.size(), file) != row.size()) {
+			fclose(file);
+			return 1;
+		}
+	}
+	return fclose(file) == 0 ? 0 : 1;
+}
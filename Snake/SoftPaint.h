@@ -0,0 +1,144 @@
+#ifndef SOFT_PAINT_H
+#define SOFT_PAINT_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "Config.h"
+#include "RenderSink.h"
+#include "Layout.h"
+#include "Shapes.h"
+#include "Rasterizer.h"
+#include "CommandBuffer.h"
+
+// 32-bit 0xAARRGGBB pixels, rows top to bottom
+struct Bitmap {
+	int width = 0;
+	int height = 0;
+	std::vector<uint32_t> pixels;
+};
+
+/************************************************************************
+*	CPU counterpart of Paint: draws the same shapes, text and bitmaps	*
+*	into a framebuffer in memory, so frames can be rendered and timed	*
+*	where there is no Direct2D. Bitmaps are read from binary PPM files	*
+*	and text uses a built-in 5 x 7 dot font.							*
+*																		*
+*	Frames are kept between calls, so a frame of commands only paints	*
+*	the background and the shapes back over the cells that changed.	*
+************************************************************************/
+class SoftPaint : public RenderSink {
+private:
+	BoardSize board;
+	// size of one cell in pixels, cells are kept square
+	int field_width;
+	int field_height;
+
+	int width;
+	int height;
+	std::vector<uint32_t> pixels;
+
+	Bitmap bg_bitmap;
+	Bitmap logo_bitmap;
+
+	Rasterizer rasterizer;
+
+	// the last full frame is still in pixels, see keepsLastFrame()
+	bool frame_kept = false;
+	// drawing only touches pixels inside the clip rectangle
+	int clip_x0;
+	int clip_y0;
+	int clip_x1;
+	int clip_y1;
+
+	// Parts of the screen that rarely change, rendered once into a
+	// buffer of their own and only copied afterwards
+	std::vector<uint32_t> board_layer;
+	std::vector<uint32_t> game_over_layer;
+	std::wstring game_over_text;
+	bool game_over_shown = false; // and still on screen
+
+	// Every shape in all four rotations, flattened and scaled to a cell
+	// at the origin of the board; drawing only has to move it to its cell
+	std::vector<RasterPoint> shape_cache[SHAPE_COUNT][4];
+	// the figure being drawn, moved to its place on the board
+	std::vector<RasterPoint> placed;
+	// fill and outline colors of a straight run, in screen order
+	std::vector<uint32_t> run_fill;
+	std::vector<uint32_t> run_outline;
+
+	void createShapeCache();
+
+	void fillPolygon(const std::vector<RasterPoint>& points, float dx, float dy, Color color);
+
+	void fillShape(int shape, int x, int y, int orientation, Color color);
+
+	void fillRect(float x0, float y0, float x1, float y1, Color color);
+
+	void drawBitmap(const Bitmap& bitmap, int x0, int y0, int x1, int y1);
+
+	void addGlyph(wchar_t c, float x, float y);
+
+	void setClip(int x0, int y0, int x1, int y1);
+
+	void resetClip();
+
+	void beginLayer(std::vector<uint32_t>& layer);
+
+	void endLayer(std::vector<uint32_t>& layer);
+
+	void drawLayer(const std::vector<uint32_t>& layer);
+
+public:
+	SoftPaint(BoardSize size, int width = WIN_WIDTH, int height = WIN_HEIGHT);
+
+	static int loadPPM(const char* file_name, Bitmap& bitmap);
+
+	int loadBitmaps(const char* bg_file_name, const char* logo_file_name);
+
+	void setBackground(Color color);
+
+	void beginDraw();
+
+	int endDraw();
+
+	void writeText(const wchar_t* text, Color color, int len, float x, float y);
+
+	void drawBgBitmap();
+
+	int drawStraightSegment(int x, int y, int orientation, Color color) override;
+
+	int drawCurvedSegment(int x, int y, int orientation, Color color) override;
+
+	int drawStraightRun(int x, int y, int orientation, int length, const Color* colors) override;
+
+	int drawHead(int x, int y, int orientation) override;
+
+	int drawTail(int x, int y, int orientation) override;
+
+	void drawBorders(float width);
+
+	int drawCandy(int x, int y, Color color) override;
+
+	int drawEatingAnimation(int x, int y, int orientation, Color color) override;
+
+	int drawCommands(CommandBuffer& commands) override;
+
+	bool keepsLastFrame() const override;
+
+	void drawLogo();
+
+	// The whole game-over screen: logo and text over a plain background
+	int drawGameOver(const wchar_t* text, int len);
+
+	const uint32_t* getPixels() const;
+
+	int getWidth() const;
+
+	int getHeight() const;
+
+	int savePPM(const char* file_name) const;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler(int threads) {
+	thread_count = threads > 0 ? threads : (int) std::thread::hardware_concurrency();
+	if (thread_count < 1) {
+		thread_count = 1;
+	}
+	slices = std::make_unique<Slice[]>(thread_count);
+	for (int worker = 0; worker < thread_count; worker++) {
+		slices[worker].range.store(0);
+	}
+	for (int worker = 1; worker < thread_count; worker++) {
+		this->threads.emplace_back(&TaskScheduler::workerLoop, this, worker);
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+bool TaskScheduler::takeOwn(int worker, uint32_t& task) {
+	std::atomic<uint64_t>& range = slices[worker].range;
+	uint64_t current = range.load(std::memory_order_acquire);
+	while (true) {
+		uint32_t begin = (uint32_t) (current >> 32);
+		uint32_t end = (uint32_t) current;
+		if (begin >= end) {
+			return false;
+		}
+		if (range.compare_exchange_weak(current, pack(begin + 1, end), std::memory_order_acq_rel)) {
+			task = begin;
+			return true;
+		}
+	}
+}
+
+bool TaskScheduler::steal(int worker) {
+	for (int offset = 1; offset < thread_count; offset++) {
+		std::atomic<uint64_t>& range = slices[(worker + offset) % thread_count].range;
+		uint64_t current = range.load(std::memory_order_acquire);
+		while (true) {
+			uint32_t begin = (uint32_t) (current >> 32);
+			uint32_t end = (uint32_t) current;
+			if (begin >= end) {
+				break;
+			}
+			uint32_t half = (end - begin + 1) / 2;
+			if (range.compare_exchange_weak(current, pack(begin, end - half), std::memory_order_acq_rel)) {
+				// our own slice is empty, so nobody else can be changing it
+				slices[worker].range.store(pack(end - half, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::runWorker(int worker) {
+	uint32_t task;
+	do {
+		while (takeOwn(worker, task)) {
+			(*job)((int64_t) task, worker);
+		}
+	} while (steal(worker));
+}
+
+void TaskScheduler::workerLoop(int worker) {
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+		runWorker(worker);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy_workers--;
+		}
+		work_done.notify_one();
+	}
+}
+
+void TaskScheduler::parallelFor(int64_t count, const std::function<void(int64_t, int)>& fn) {
+	if (count <= 0) {
+		return;
+	}
+	for (int worker = 0; worker < thread_count; worker++) {
+		uint32_t begin = (uint32_t) (count * worker / thread_count);
+		uint32_t end = (uint32_t) (count * (worker + 1) / thread_count);
+		slices[worker].range.store(pack(begin, end), std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &fn;
+		busy_workers = thread_count - 1;
+		generation++;
+	}
+	work_ready.notify_all();
+
+	runWorker(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [&] { return busy_workers == 0; });
+	job = nullptr;
+}
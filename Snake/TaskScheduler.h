@@ -0,0 +1,66 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstdint>
+
+/************************************************************************
+*	Fixed pool of worker threads running independent tasks.				*
+*	parallelFor hands every worker an equal slice of the task range.	*
+*	A worker takes tasks from the front of its own slice; once it is	*
+*	empty it steals the back half of another worker's slice. A slice	*
+*	is one 64-bit atomic (begin, end), so both take a single CAS and	*
+*	no lock is held while tasks run.									*
+************************************************************************/
+class TaskScheduler {
+private:
+	struct alignas(64) Slice {
+		std::atomic<uint64_t> range;
+	};
+
+	int thread_count;
+	std::vector<std::thread> threads;
+	std::unique_ptr<Slice[]> slices;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+	uint64_t generation = 0;
+	int busy_workers = 0;
+	bool stopping = false;
+	const std::function<void(int64_t, int)>* job = nullptr;
+
+	static inline uint64_t pack(uint32_t begin, uint32_t end) {
+		return ((uint64_t) begin << 32) | end;
+	}
+
+	bool takeOwn(int worker, uint32_t& task);
+	bool steal(int worker);
+	void runWorker(int worker);
+	void workerLoop(int worker);
+
+public:
+	// 0 threads means one per hardware thread
+	TaskScheduler(int threads = 0);
+	~TaskScheduler();
+
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+	inline int threadCount() const {
+		return thread_count;
+	}
+
+	// Calls fn(task, worker) for every task in [0, count) with worker in
+	// [0, threadCount()); returns once all of them are done. The calling
+	// thread works as worker 0. count must fit in 32 bits.
+	void parallelFor(int64_t count, const std::function<void(int64_t, int)>& fn);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Unsigned LEB128: seven bits a byte, lowest first, the high bit set on
+// every byte but the last
+inline void putVarint(std::vector<uint8_t>& bytes, uint64_t value) {
+	while (value >= 0x80) {
+		bytes.push_back((uint8_t) (value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t) value);
+}
+
+// Reads a varint at position and moves past it; 1 if the data ends
+// first or the value doesn't fit 64 bits
+inline int getVarint(const uint8_t* data, std::size_t size, std::size_t& position, uint64_t& value) {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (position >= size) {
+			return 1;
+		}
+		uint8_t byte = data[position++];
+		value |= (uint64_t) (byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#endif
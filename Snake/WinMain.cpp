@@ -8,9 +8,17 @@
 #include <chrono>
 #include <ctime>
 #include <cwchar>
+#include <string>
+#include <vector>
+#include <memory>
 
 #include "Paint.h"
 #include "Snake.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "Replay.h"
+#include "Autopilot.h"
+#include "Mcts.h"
 
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -22,13 +30,131 @@ using D2D1::SizeU;
 
 Snake* snake = nullptr;
 Paint* paint = nullptr;
+FrameScheduler scheduler(SPEED);
+
+// Every game played is added to this file when it ends
+const wchar_t REPLAY_FILE[] = L"snake-replays.snkr";
+// Game n of a session plays stream n of its seed
+uint64_t seed = 0;
+uint64_t game_number = 0;
+ReplayWriter recorder;
+
+// With a replay file on the command line its games are played back one
+// after another, then the game goes on as usual
+std::vector<uint8_t> playback_data;
+ReplayReader playback(nullptr, 0);
+bool playing_back = false;
+
+// A toggles the autopilot, which steers the way the arrow keys do
+AutopilotAgent autopilot;
+bool autopilot_on = false;
+// M toggles the tree search, which thinks for most of every tick on all
+// cores; it is only made the first time it is switched on
+std::unique_ptr<MctsAgent> tree_search;
+bool search_on = false;
+
+// The next game from the replay file on this board, or a new one once
+// it has no more
+void startGame() {
+    ReplayHeader header;
+    BoardSize board = snake->getBoardSize();
+    playing_back = false;
+    while (!playing_back && !playback.atEnd()) {
+        if (playback.begin(header) != 0) {
+            playback.seek(playback_data.size()); // the rest can't be read
+            break;
+        }
+        playing_back = header.board.width == board.width && header.board.height == board.height;
+        // a game on another board is passed over, so the next one is
+        // read from its start
+        if (!playing_back && playback.skip() != 0) {
+            playback.seek(playback_data.size());
+        }
+    }
+    if (playing_back) {
+        snake->restart(header.seed, header.stream);
+    }
+    else {
+        game_number++;
+        snake->restart(seed, game_number);
+        recorder.begin(ReplayHeader{ board, seed, game_number });
+    }
+    autopilot.reset(board, seed, game_number);
+    if (tree_search) {
+        tree_search->reset(board, seed, game_number);
+    }
+    scheduler.start(FrameScheduler::Clock::now());
+}
+
+void endGame() {
+    if (playing_back) {
+        playback.skip(); // to the start of the next game
+        return;
+    }
+    recorder.finish(*snake, snake->game_end);
+    appendReplayFile(REPLAY_FILE, recorder.data());
+}
+
+// Runs the ticks that are due and asks for a repaint if anything moved
+void advanceGame(HWND hwnd) {
+    if (!snake->running) {
+        return;
+    }
+    int ticks = scheduler.ticksDue(FrameScheduler::Clock::now());
+    for (int i = 0; i < ticks && snake->running; i++) {
+        if (playing_back) {
+            Action action;
+            if (!playback.nextTick(action)) {
+                // the recorded game was cut short here
+                snake->running = false;
+                snake->game_end = GameEnd::TIMEOUT;
+                break;
+            }
+            snake->turn(action);
+        }
+        else {
+            if (autopilot_on) {
+                snake->turn(autopilot.decide(*snake));
+            }
+            else if (search_on) {
+                snake->turn(tree_search->decide(*snake));
+            }
+            recorder.record(*snake);
+        }
+        snake->moveOneStep();
+    }
+    if (!snake->running) {
+        endGame();
+    }
+    if (ticks > 0) {
+        InvalidateRect(hwnd, nullptr, FALSE);
+    }
+}
+
+// How long the message loop may sleep before the next tick is due
+DWORD millisecondsToNextTick() {
+    if (!snake->running) {
+        return INFINITE; // the game-over screen only changes on input
+    }
+    auto wait = scheduler.timeUntilNextTick(FrameScheduler::Clock::now());
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+    return static_cast<DWORD>(ms);
+}
+
+#ifdef SNAKE_PROFILE
+// Timings go next to the executable, on exit or when P is pressed
+void saveProfile() {
+    profiler.writeCSV("snake-profile.csv");
+    profiler.writeJSON("snake-profile.json");
+}
+#endif
 
 // if something doesn't work, please try changing CALLBACK to WINAPI
 // whenever I changed though i got a Warning 
 int CALLBACK wWinMain(
     _In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
-    _In_ LPWSTR,
+    _In_ LPWSTR lpCmdLine,
     _In_ int nShowCmd) {
     // Register the window class.
     const wchar_t CLASS_NAME[] = L"Sample Window Class";
@@ -74,34 +200,61 @@ int CALLBACK wWinMain(
         return 1; // error creating the window
     }
 
+    // The board size can be given on the command line, e.g. "Snake.exe 20x20",
+    // or a file of replays to play back, on the board they were played on
+    BoardSize board = DEFAULT_BOARD;
+    int width, height;
+    if (swscanf(lpCmdLine, L"%dx%d", &width, &height) == 2 && width >= 2 && height >= 1) {
+        board = BoardSize{ width, height };
+    }
+    else if (lpCmdLine[0] != L'\0') {
+        std::wstring path = lpCmdLine;
+        if (path.size() >= 2 && path.front() == L'"' && path.back() == L'"') {
+            path = path.substr(1, path.size() - 2);
+        }
+        if (readReplayFile(path, playback_data)) {
+            return 1;
+        }
+        playback = ReplayReader(playback_data.data(), playback_data.size());
+        ReplayHeader header;
+        ReplayReader first(playback_data.data(), playback_data.size());
+        if (first.begin(header) == 0) {
+            board = header.board;
+        }
+    }
+
     ShowWindow(hwnd, nShowCmd);
-    paint = new Paint();
+    paint = new Paint(board);
     if (paint->createResources(hwnd) == 1) {
         return 1;
     }
-    snake = new Snake(paint);
+    seed = (uint64_t) std::time(nullptr);
+    snake = new Snake(paint, board, seed);
+    startGame();
 
-    auto clock = std::chrono::system_clock::now();
-    auto since_epoch = clock.time_since_epoch();
-    auto milis = std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch);
-    long long time = milis.count();
-    snake->last_time = time;
-
-    // Run the message loop.
+    // Run the message loop. It sleeps until either a message arrives or
+    // the next tick is due, so an idle game costs no CPU.
 
     MSG msg = { };
-    INT retGetMess = GetMessage(&msg, nullptr, 0, 0);
-    while (retGetMess > 0)
-    {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
-        retGetMess = GetMessage(&msg, nullptr, 0, 0);
-    }
-
-    if (retGetMess == -1) {
-        return 1;
+    bool quit = false;
+    while (!quit) {
+        MsgWaitForMultipleObjectsEx(0, nullptr, millisecondsToNextTick(), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) {
+                quit = true;
+                break;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        if (!quit) {
+            advanceGame(hwnd);
+        }
     }
 
+#ifdef SNAKE_PROFILE
+    saveProfile();
+#endif
     delete snake;
     delete paint;
     return 0;
@@ -115,59 +268,71 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         PostQuitMessage(0);
         return 0;
 
-    case WM_TIMER:
-        InvalidateRect(hwnd, nullptr, FALSE);
+    case WM_SIZE:
+        // the first one comes before the renderer exists
+        if (paint != nullptr && paint->resize(hwnd)) {
+            return 1;
+        }
         return 0;
 
     case WM_KEYDOWN:
-        if (wParam == VK_RIGHT && !snake->orientation_changed) {
-            snake->new_orientation = (snake->orientation + 1) % 4;
-            snake->orientation_changed = true;
+    {
+#ifdef SNAKE_PROFILE
+        if (wParam == 0x50) { // "P"
+            saveProfile();
+            return 0;
         }
-        if (wParam == VK_LEFT && !snake->orientation_changed) {
-            snake->orientation_changed = true;
-            snake->new_orientation = (snake->orientation + 3) % 4;
+#endif
+        PROFILE_SCOPE(PHASE_INPUT);
+        // a game being played back only takes its recorded turns
+        if (wParam == VK_RIGHT && !playing_back) {
+            snake->turn(Action::RIGHT);
+        }
+        if (wParam == VK_LEFT && !playing_back) {
+            snake->turn(Action::LEFT);
+        }
+        if (wParam == 0x41) { // "A"
+            autopilot_on = !autopilot_on;
+        }
+        if (wParam == 0x4D) { // "M"
+            if (!tree_search) {
+                tree_search = std::make_unique<MctsAgent>();
+                tree_search->reset(snake->getBoardSize(), seed, game_number);
+            }
+            search_on = !search_on;
         }
         if (wParam == 0x52 && !snake->running) { // "R" 
-            snake->restart();
+            startGame();
+            InvalidateRect(hwnd, nullptr, FALSE);
         }
-        return 0;
+    }
+    return 0;
 
     case WM_PAINT:
     {
         paint->beginDraw();
  
         if (snake->running) {
-            paint->drawBgBitmap();
-            paint->drawBorders(BOARDER_WIDTH);
-            auto clock = std::chrono::system_clock::now();
-            auto since_epoch = clock.time_since_epoch();
-            auto milis = std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch);
-            long long time = milis.count();
-            long long time_diff = time - snake->last_time;
-            if (time_diff > 1000 * SPEED) {
-                snake->moveOneStep();
-                snake->last_time = time;
-            }
-            HRESULT hr = snake->draw();
-            if (FAILED(hr)) {
+            // repaints only the cells that changed since the last frame
+            if (snake->draw()) {
                 return 1;
             }
         }
         else {
-            paint->setBackground(D2D1::ColorF(0.8f, 0.8f, 0.8f));
-            paint->drawLogo();
-            wchar_t text[45] = L"Kliknij R aby zrestartować\nUzyskany wynik: ";
-            int bufferSize = swprintf(nullptr, 0, L"%s%d", text, abs(snake->len));
-            WCHAR* formattedText = new WCHAR[bufferSize + 1];
-            swprintf(formattedText, bufferSize + 1, L"%s%d", text, abs(snake->len));
-
-            paint->writeText(formattedText, D2D1::ColorF(0.0f, 0.0f, 0.0f), bufferSize, MARGIN, MARGIN);
+            // drawn once per score, later frames only copy the cached screen
+            WCHAR text[64];
+            int len = swprintf(text, 64, L"Kliknij R aby zrestartować\nUzyskany wynik: %d", abs(snake->len));
+            if (len < 0 || paint->drawGameOver(text, len)) {
+                return 1;
+            }
         }
 
+        PROFILE_SCOPE(PHASE_PRESENT);
         if (paint->endDraw(hwnd)) {
             return 1; // restoring render target
         }
+        // the frame is up to date, otherwise WM_PAINT keeps coming back
+        ValidateRect(hwnd, nullptr);
     }
     return 0;
 